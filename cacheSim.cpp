@@ -15,14 +15,116 @@
 #include <vector>
 #include <bitset>
 #include <cmath>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <map>
+#include <list>
+#include <set>
+#include <unordered_map>
+#include <type_traits>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <cctype>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#include <poll.h>
+#include <csignal>
 #include <boost/tokenizer.hpp>
 #include <boost/lexical_cast.hpp>
+#include "cacheSimPlugin.h"
+#include "cacheTraceEmitter.hpp"
 
 // for readability
 typedef boost::tokenizer< boost::char_separator<char> > Tokens;
 
-// tracks whether a memory reference is read or write
-enum class ReadOrWrite {ERROR, READ, WRITE};
+// tracks whether a memory reference is read or write, or one of the
+// cache maintenance records: a line invalidate (clflush), a full flush,
+// or an address space switch
+enum class ReadOrWrite {ERROR, READ, WRITE, INVALIDATE, FLUSH, SWITCH};
+
+// selects how the decoded trace is run against the cache
+enum class SimEngine {SERIAL, PARALLEL, FAST_FORWARD};
+
+// where a newly filled line goes in the LRU order. MRU is plain LRU, LIP
+// inserts at the LRU end, BIP inserts at the MRU end once every
+// bipThrottle_ fills on average, and DIP picks LRU or BIP with set dueling
+enum class InsertionPolicy {MRU, LIP, BIP, DIP};
+
+// the kinds of messages passed between levels of a cache hierarchy.
+// INVALIDATE is a back-invalidation flowing up, FLUSH_LINE and FLUSH_ALL
+// carry invalidate and flush records from the trace down
+enum class LevelOp {READ, WRITE, INVALIDATE, FLUSH_LINE, FLUSH_ALL, END};
+
+struct LevelMessage {
+  LevelOp op;
+  unsigned long address;
+};
+
+template <typename T>
+class SpscQueue {
+
+  /* a lock-free ring buffer with one producer thread and one consumer
+  thread. used to connect the levels of a pipelined cache hierarchy */
+
+  public:
+
+    // capacity must be a power of two
+    SpscQueue(size_t capacity = 4096)
+      : buffer_(capacity), mask_(capacity - 1), head_(0), tail_(0) {}
+
+    // spins while the queue is full
+    void push(const T &item) {
+      size_t tail = tail_.load(std::memory_order_relaxed);
+      while (tail - head_.load(std::memory_order_acquire) == buffer_.size()) {
+        std::this_thread::yield();
+      }
+      buffer_[tail & mask_] = item;
+      tail_.store(tail + 1, std::memory_order_release);
+    }
+
+    // returns false if the queue is empty
+    bool pop(T &item) {
+      size_t head = head_.load(std::memory_order_relaxed);
+      if (head == tail_.load(std::memory_order_acquire)) {
+        return false;
+      }
+      item = buffer_[head & mask_];
+      head_.store(head + 1, std::memory_order_release);
+      return true;
+    }
+
+  private:
+
+    std::vector<T>
+      buffer_;
+
+    size_t
+      mask_;
+
+    std::atomic<size_t>
+      head_,
+      tail_;
+
+}; // end class SpscQueue
+
+
+struct LevelLink {
+  /* connects a cache level to the level below it. misses and writebacks
+  flow down through requests, back-invalidations flow up through
+  invalidations, and completed counts the requests the lower level has
+  finished so an inclusive upper level can wait for them */
+  SpscQueue<LevelMessage> requests;
+  SpscQueue<LevelMessage> invalidations;
+  std::atomic<unsigned long> completed{0};
+};
 
 class MemRef {
 /* keeps track of memory references. this is used for comparison with
@@ -45,6 +147,14 @@ the cache table and for printing the summary at the end */
       newTag_ = newTag;
     }
 
+    void setAsid(unsigned int asid) {
+      asid_ = asid;
+    }
+
+    void setCore(int core) {
+      core_ = core;
+    }
+
     // getters 
     ReadOrWrite getRW() {
       return rW_;
@@ -78,10 +188,23 @@ the cache table and for printing the summary at the end */
       return hM_;
     }
 
+    // true for reads and writes, which are the records that hit or miss
+    bool is_access() {
+      return rW_ == ReadOrWrite::READ || rW_ == ReadOrWrite::WRITE;
+    }
+
     int getSize() {
       return size_;
     }
 
+    unsigned int getAsid() {
+      return asid_;
+    }
+
+    int getCore() {
+      return core_;
+    }
+
     // these calculate various parts of the cache line
     void calculate_tag(unsigned long indexSize, unsigned long offsetSize) {
       tag_ = address_ >> (indexSize + offsetSize);
@@ -103,10 +226,15 @@ the cache table and for printing the summary at the end */
 
     int 
       refNum_,
-      size_;
+      size_,
+      core_ = 0;
+
+    // address space the reference was made in
+    unsigned int
+      asid_ = 0;
 
     bool 
-      hM_;
+      hM_ = false;
 
     unsigned long
       address_,
@@ -117,6 +245,10 @@ the cache table and for printing the summary at the end */
 
 }; // end class MemRef
 
+// shared trace segments hold MemRefs as raw bytes
+static_assert(std::is_trivially_copyable<MemRef>::value,
+    "MemRef must be trivially copyable");
+
 
 class CacheLine {
 
@@ -134,6 +266,10 @@ class CacheLine {
       LRUFlag_ = 0;
     }
 
+    void set_LRU(unsigned long LRUFlag) {
+      LRUFlag_ = LRUFlag;
+    }
+
     void setTag(unsigned long tag) {
       tag_ = tag;
     }
@@ -151,14 +287,41 @@ class CacheLine {
       LRUFlag_++;
     }
 
+    void set_dirty(bool dirty) {
+      dirty_ = dirty;
+    }
+
+    bool is_dirty() {
+      return dirty_;
+    }
+
+    void set_valid(bool valid) {
+      valid_ = valid;
+    }
+
+    bool is_valid() {
+      return valid_;
+    }
+
+    // for directory entries, a bit per core holding a copy of the line
+    void set_sharers(unsigned long sharers) {
+      sharers_ = sharers;
+    }
+
+    unsigned long get_sharers() {
+      return sharers_;
+    }
+
   private:
 
     unsigned long 
       tag_,
-      LRUFlag_;
+      LRUFlag_,
+      sharers_ = 0;
 
     bool
-      valid_;
+      valid_ = true,
+      dirty_ = false;
 
 }; // end class CacheLine
 
@@ -186,7 +349,16 @@ class CacheSet {
     }
 
     // adds just one cache line
-    void add_new_cache_line(unsigned long tag) {
+    void add_new_cache_line(unsigned long tag, bool insertAtLRU = false) {
+      if (insertAtLRU) {
+        // goes below the current LRU line, leaving the others as they are
+        CacheLine cacheLine(tag);
+        cacheLine.set_LRU(cacheLine_.empty() ? 0 : find_LRU()->get_LRU() + 1);
+        cacheLine_.push_back(cacheLine);
+        return;
+      }
+      // age the existing lines so every line has a distinct LRU value
+      update_LRUs();
       CacheLine *cacheLine = new CacheLine(tag);
       cacheLine->set_LRU();
       cacheLine_.push_back(*cacheLine);
@@ -217,19 +389,107 @@ class CacheSet {
       }
     }
 
-    // update tag for a cache entry
-    void update_cache_lines(unsigned long tag) {
+    // update tag for a cache entry. returns true if a line had to be
+    // evicted, and copies it to evicted when one is given. with
+    // insertAtLRU the new line takes the LRU position instead of the MRU one
+    bool update_cache_lines(unsigned long tag, CacheLine *evicted = NULL,
+        bool insertAtLRU = false) {
       // is there room for a new entry?
       if (cacheLine_.size() < setSize_) {
-        add_new_cache_line(tag);
+        add_new_cache_line(tag, insertAtLRU);
+        return false;
       } else {
         // if no room, then replace the LRU entry
         std::vector<CacheLine>::iterator lineToReplace = find_LRU();
-        update_LRUs();
+        if (evicted != NULL) {
+          *evicted = *lineToReplace;
+        }
+        if (!insertAtLRU) {
+          // otherwise the new line keeps the victim's LRU value
+          update_LRUs();
+          lineToReplace->set_LRU();
+        }
         lineToReplace->setTag(tag);
-        lineToReplace->set_LRU();
+        lineToReplace->set_dirty(false);
+        return true;
+      }
+    }
+
+    // policy plugins keep metadata per way, so for them lines never move:
+    // a line is replaced in place, and invalidating it leaves an empty way
+
+    // the way holding tag, or -1
+    int find_way(unsigned long tag) {
+      for (size_t way = 0; way < cacheLine_.size(); ++way) {
+        if (cacheLine_[way].is_valid() && tag == cacheLine_[way].getTag()) {
+          return way;
+        }
+      }
+      return -1;
+    }
+
+    // an empty way for a new line, or -1 if the set is full
+    int free_way() {
+      for (size_t way = 0; way < cacheLine_.size(); ++way) {
+        if (!cacheLine_[way].is_valid()) {
+          return way;
+        }
+      }
+      if (cacheLine_.size() < (size_t)setSize_) {
+        cacheLine_.push_back(CacheLine());
+        return cacheLine_.size() - 1;
+      }
+      return -1;
+    }
+
+    void fill_way(int way, unsigned long tag) {
+      cacheLine_[way].setTag(tag);
+      cacheLine_[way].set_dirty(false);
+      cacheLine_[way].set_valid(true);
+    }
+
+    void clear_way(int way) {
+      cacheLine_[way].set_valid(false);
+    }
+
+    std::vector<CacheLine> &get_lines() {
+      return cacheLine_;
+    }
+
+    // returns the line holding tag without touching the LRU order, or NULL
+    CacheLine *find_line(unsigned long tag) {
+      for (std::vector<CacheLine>::iterator it = cacheLine_.begin();
+          it != cacheLine_.end(); ++it) {
+        if (tag == it->getTag()) {
+          return &*it;
+        }
+      }
+      return NULL;
+    }
+
+    // marks the line holding tag as modified
+    void mark_dirty(unsigned long tag) {
+      for (std::vector<CacheLine>::iterator it = cacheLine_.begin();
+          it != cacheLine_.end(); ++it) {
+        if (tag == it->getTag()) {
+          it->set_dirty(true);
+          return;
+        }
+      }
+    }
 
+    // removes the line holding tag, if any. returns true if it was found
+    // and sets wasDirty to whether it held modified data
+    bool invalidate_line(unsigned long tag, bool &wasDirty) {
+      for (std::vector<CacheLine>::iterator it = cacheLine_.begin();
+          it != cacheLine_.end(); ++it) {
+        if (tag == it->getTag()) {
+          wasDirty = it->is_dirty();
+          cacheLine_.erase(it);
+          return true;
+        }
       }
+      return false;
     }
 
     // returns an iterator to the LRU cacheLine
@@ -254,12 +514,61 @@ class CacheSet {
       index_ = index;
     }
 
+    // returns the tags in the set from most to least recently used
+    std::vector<unsigned long> recency_order() {
+      std::vector<CacheLine> lines = cacheLine_;
+      std::sort(lines.begin(), lines.end(),
+          [](CacheLine &a, CacheLine &b) { return a.get_LRU() < b.get_LRU(); });
+
+      std::vector<unsigned long> tags;
+      for (std::vector<CacheLine>::iterator it = lines.begin();
+          it != lines.end(); ++it) {
+        tags.push_back(it->getTag());
+      }
+      return tags;
+    }
+
+    // a set whose epoch differs from the cache's was flushed since it was
+    // last used, so it is emptied the first time it is touched again.
+    // this keeps a full flush O(1) no matter how big the cache is
+    void sync_epoch(unsigned long epoch) {
+      if (epoch_ != epoch) {
+        cacheLine_.clear();
+        epoch_ = epoch;
+      }
+    }
+
+    void set_epoch(unsigned long epoch) {
+      epoch_ = epoch;
+    }
+
+    // two sets with the same tags in the same LRU order will produce the
+    // same hits and misses for any future references
+    bool same_state(CacheSet &other) {
+      if (cacheLine_.size() != other.cacheLine_.size()) {
+        return false;
+      }
+      return recency_order() == other.recency_order();
+    }
+
+    // moves every tag in the set by a constant, used when a loop with a
+    // stride that keeps the same index is fast-forwarded
+    void shift_tags(long tagDelta) {
+      for (std::vector<CacheLine>::iterator it = cacheLine_.begin();
+          it != cacheLine_.end(); ++it) {
+        it->setTag(it->getTag() + tagDelta);
+      }
+    }
+
   private:
 
     unsigned int
       setSize_,
-      indexSize_,
-      index_;
+      indexSize_ = 0,
+      index_ = 0;
+
+    unsigned long
+      epoch_ = 0;
 
     std::vector<CacheLine>
       cacheLine_;
@@ -267,340 +576,6134 @@ class CacheSet {
 }; // end class CacheSet
 
 
-class CacheTable
-{
-  /* the main cache table that stores the sets and lines */
-
-  public:
-
-    CacheTable(){}
-
-    // parameterized constructor
-    CacheTable 
-      (int totalCacheSize, int lineSize, int setSize) 
-      : totalCacheSize_(totalCacheSize), lineSize_(lineSize), 
-      setSize_(setSize) {}
-
-    int print_summary() {
-      std::cout << std::dec
-        << "\nTotal Cache Size:  " << get_total_cache_size() << "B"
-        << "\nLine Size:  " << get_line_size() << "B"
-        << "\nSet Size:  " << get_set_size()
-        << "\nNumber of Sets:  " << get_number_of_sets() << "\n"
-        << std::endl;
+// how PageTable picks a physical frame for a newly touched page
+enum class PageAllocation {RANDOM, SEQUENTIAL, COLORING};
 
-      // much of this formatting is from Dr. Hughes supplement
+class PageTable {
 
-      std::cout << std::setw(8)  << std::left << "RefNum";
-      std::cout << std::setw(10) << std::left << "  R/W";
-      std::cout << std::setw(13) << std::left << "Address";
-      std::cout << std::setw(6)  << std::left << "Tag";
-      std::cout << std::setw(8)  << std::left << "Index";
-      std::cout << std::setw(10) << std::left << "Offset";
-      std::cout << std::setw(8)  << std::left << "H/M";
-      std::cout << std::setfill('*') << std::setw(64) << "\n" << std::setfill(' ');
-      std::cout << "\n";
+  /* translates virtual addresses to physical ones for each address space,
+  allocating a frame the first time a page is touched. the mapping lives in
+  an open-addressing hash table keyed by address space and page number */
 
-      std::vector<MemRef>::iterator it = memRef_.begin();
-      for (int i = 0; i < (memRef_.size()); ++i) {
+  public:
 
-        std::cout << "   " << std::setw(5) << std::left << std::dec 
-          << it->getRefNum();
+    // pageSize must be a power of two. colors is the number of page
+    // colors of the cache being modelled, used by COLORING
+    PageTable(PageAllocation allocation, unsigned long pageSize,
+        unsigned long physicalFrames, unsigned long colors, unsigned long seed)
+      : allocation_(allocation), pageBits_(log2(pageSize)),
+      physicalFrames_(physicalFrames), colors_(std::max(1UL, colors)),
+      random_(seed | 1), frameUsed_(physicalFrames, false),
+      nextInColor_(colors_, 0), entries_(1024) {}
+
+    unsigned long translate(unsigned int asid, unsigned long address) {
+      unsigned long vpn = address >> pageBits_;
+      unsigned long offset = address & ((1UL << pageBits_) - 1);
+      return (lookup(asid, vpn) << pageBits_) | offset;
+    }
 
-        if (it->getRW() == ReadOrWrite::READ) {
-          std::cout << std::setw(8) << " Read";
-        } else {
-          std::cout << std::setw(8) << "Write";
-        }
+    unsigned long get_pages_mapped() {
+      return pagesMapped_;
+    }
 
-        std::cout << "  " << std::setfill('0') << std::setw(8) 
-          << std::right << std::hex << it->getAddress();
-        std::cout << std::setfill(' ') << std::setw(7) << it->getTag()
+    unsigned long get_frames_reused() {
+      return framesReused_;
+    }
 
-          << std::setw(8) << std::dec << it->getIndex()
-          << std::setw(8) << it->getOffset();
+  private:
 
-        if (it->getHM() == false) {
-          std::cout << std::setw(10) << "Miss";
-        } else {
-          std::cout << std::setw(10) << "Hit";
+    struct Entry {
+      unsigned long vpn;
+      unsigned long pfn;
+      unsigned int asid;
+      bool used;
+    };
+
+    // finds the frame for a page, allocating one on first touch
+    unsigned long lookup(unsigned int asid, unsigned long vpn) {
+      size_t mask = entries_.size() - 1;
+      size_t slot = hash(asid, vpn) & mask;
+      while (entries_[slot].used) {
+        if (entries_[slot].vpn == vpn && entries_[slot].asid == asid) {
+          return entries_[slot].pfn;
         }
-        std::cout << std::dec << std::endl;
-
-        ++it;
+        slot = (slot + 1) & mask;
       }
 
-      // cast as doubles for division
-      hitRate = (double)(totalHits) / (double)totalAccess;
-      missRate = (double)totalMiss / (double)totalAccess;
-
-      std::cout << "\n";
-      std::cout << "    Simulation Summary\n";
-      std::cout << "**************************\n";
-      std::cout << "Total Hits:\t"   << (totalHits) << "\n";
-      std::cout << "Total Misses:\t" << totalMiss << "\n";
-      std::cout << "Hit Rate:\t"     << std::setprecision(5) << hitRate   << "\n";
-      std::cout << "Miss Rate:\t"    << std::setprecision(5) << missRate  << "\n";
-
+      unsigned long pfn = allocate_frame(vpn);
+      Entry entry = {vpn, pfn, asid, true};
+      entries_[slot] = entry;
+      // keep the load factor at or below one half
+      if (++pagesMapped_ * 2 > entries_.size()) {
+        grow();
+      }
+      return pfn;
     }
 
-    void increment_number_of_sets() {
-      numberOfSets_++;
+    unsigned long allocate_frame(unsigned long vpn) {
+      unsigned long pfn = 0;
+      if (pagesMapped_ >= physicalFrames_) {
+        // physical memory is full, so frames start being shared
+        framesReused_++;
+        return next_random() % physicalFrames_;
+      }
+      switch (allocation_) {
+        case PageAllocation::RANDOM:
+          do {
+            pfn = next_random() % physicalFrames_;
+          } while (frameUsed_[pfn]);
+          break;
+        case PageAllocation::SEQUENTIAL:
+          while (frameUsed_[nextFrame_]) {
+            nextFrame_ = (nextFrame_ + 1) % physicalFrames_;
+          }
+          pfn = nextFrame_;
+          break;
+        case PageAllocation::COLORING: {
+          // keep the page's color, so it maps to the same cache sets it
+          // would have with virtual indexing. falls back to any free frame
+          // once that color runs out
+          unsigned long color = vpn % colors_;
+          pfn = color + colors_ * nextInColor_[color];
+          while (pfn < physicalFrames_ && frameUsed_[pfn]) {
+            nextInColor_[color]++;
+            pfn = color + colors_ * nextInColor_[color];
+          }
+          if (pfn >= physicalFrames_) {
+            while (frameUsed_[nextFrame_]) {
+              nextFrame_ = (nextFrame_ + 1) % physicalFrames_;
+            }
+            pfn = nextFrame_;
+          }
+          break;
+        }
+      }
+      frameUsed_[pfn] = true;
+      return pfn;
     }
 
-    void calculate_number_of_sets() {
-      // make sure lineSize_ > 0
-      if ((lineSize_ != 0) && (setSize_ != 0)) {
-        numberOfSets_ = (totalCacheSize_ / lineSize_) / setSize_;
+    void grow() {
+      std::vector<Entry> old(entries_.size() * 2);
+      old.swap(entries_);
+      size_t mask = entries_.size() - 1;
+      for (std::vector<Entry>::iterator it = old.begin(); it != old.end(); ++it) {
+        if (it->used) {
+          size_t slot = hash(it->asid, it->vpn) & mask;
+          while (entries_[slot].used) {
+            slot = (slot + 1) & mask;
+          }
+          entries_[slot] = *it;
+        }
       }
     }
 
-    // these calculate the dimensions of various cache properties
-    void calculate_index_size() {
-      indexSize_ = log2(numberOfSets_);
+    static size_t hash(unsigned int asid, unsigned long vpn) {
+      unsigned long x = vpn ^ ((unsigned long)asid << 47);
+      x ^= x >> 33;
+      x *= 0xff51afd7ed558ccdUL;
+      x ^= x >> 33;
+      return x;
     }
 
-    void calculate_offset_size() {
-      offsetSize_ = log2(lineSize_);
+    // xorshift64
+    unsigned long next_random() {
+      random_ ^= random_ << 13;
+      random_ ^= random_ >> 7;
+      random_ ^= random_ << 17;
+      return random_;
     }
 
-    void calculate_tag_size() {
-      tagSize_ = (lineSize_ * 8) - indexSize_ - offsetSize_;
-    }
+    PageAllocation
+      allocation_;
 
-    void calculate_offset_mask() {
-      offsetMask_ = pow(2, offsetSize_) - 1;
-    }
+    unsigned long
+      pageBits_,
+      physicalFrames_,
+      colors_,
+      random_,
+      nextFrame_ = 0,
+      pagesMapped_ = 0,
+      framesReused_ = 0;
 
-    void calculate_index_mask() {
-      indexMask_ = (pow(2, (indexSize_ + offsetSize_)) - 1) - offsetMask_;
-    }
+    std::vector<bool>
+      frameUsed_;
 
-    void calculate_tag_mask() {
-      tagMask_ = pow(2, (lineSize_ * 8)) - 1 - indexMask_ - offsetMask_;
-    }
+    std::vector<unsigned long>
+      nextInColor_;
 
-    // reads the cache configuration files
-    int read_cache_config(char* filename) {
-      // open the input file
-      std::ifstream is;
-      // read first file
-      is.open(filename, std::ios::in);
-      // return 1 if file not found
-      if (is.fail()) {
-        std::cerr << "\nError opening file: \"" << filename 
-          << "\"\n" << std::endl;
-        return 1;
-      }
-      is >> setSize_;
-      is >> lineSize_;
-      is >> totalCacheSize_;
+    std::vector<Entry>
+      entries_;
 
-      is.close();
-    }
+}; // end class PageTable
 
-    // reads and parses the memory trace files 
-    int read_mem_trace(char* filename) {
-      /* The memory trace should have the format: 
-         <accesstype>:<size>:<hexaddress>
-         */
-      // open the input file
-      std::ifstream is;
-      std::string input;
-      // read first file
-      is.open(filename, std::ios::in); // input stream
-      // return 1 if file not found
-      if (is.fail()) {
-        std::cerr << "\nError opening file: \"" << filename 
-          << "\"\n" << std::endl;
-        return 1;
-      }
-      int refNum = 0;
-      ReadOrWrite rW = ReadOrWrite::ERROR;
-      int size = 0;
-      unsigned long address = 0;
 
+class ConflictGraph {
 
-      // clearing the whitespace seemed necessary for the getline
-        std::ws(is);
-      while (std::getline(is, input)) {
+  /* records which address regions evict each other. every eviction adds
+  one to the edge from the evictor's region to the victim's region, and
+  the edges are kept in a Space-Saving sketch of bounded size: when it is
+  full, a new edge replaces the smallest one and inherits its count as the
+  error. the counts of the edges kept are never undercounted, and any edge
+  with more than evictions/capacity evictions is guaranteed to be kept */
 
-        std::ws(is);
-        // define delimeters
-        boost::char_separator<char> delimeter(":");
+  public:
 
-        // tokenize string according to delimeter
-        Tokens tokens(input, delimeter);
+    // regionSize must be a power of two
+    ConflictGraph(size_t capacity, unsigned long regionSize, int sets)
+      : capacity_(std::max(capacity, (size_t)1)),
+      regionBits_(log2(regionSize)), evictionsPerSet_(sets, 0) {}
+
+    void record(unsigned long index, unsigned long evictorAddress,
+        unsigned long victimAddress) {
+      evictions_++;
+      evictionsPerSet_[index]++;
+      RegionPair edge(evictorAddress >> regionBits_,
+          victimAddress >> regionBits_);
+
+      std::map<RegionPair, Counter>::iterator it = edges_.find(edge);
+      if (it != edges_.end()) {
+        byCount_.erase(std::make_pair(it->second.count, edge));
+        it->second.count++;
+        byCount_.insert(std::make_pair(it->second.count, edge));
+        return;
+      }
+      Counter counter = {1, 0};
+      if (edges_.size() >= capacity_) {
+        // the new edge takes over the smallest counter
+        std::pair<unsigned long, RegionPair> smallest = *byCount_.begin();
+        byCount_.erase(byCount_.begin());
+        edges_.erase(smallest.second);
+        counter.count = smallest.first + 1;
+        counter.error = smallest.first;
+      }
+      edges_[edge] = counter;
+      byCount_.insert(std::make_pair(counter.count, edge));
+    }
 
-        // iterate through tokens
-        Tokens::iterator token = tokens.begin();
-        if (*token == "R") {
-          rW = ReadOrWrite::READ;
-        } 
-        else if (*token == "W") {
-          rW = ReadOrWrite::WRITE;
+    void print_summary(size_t shown) {
+      std::cout << "\n";
+      std::cout << "     Conflict Summary\n";
+      std::cout << "**************************\n";
+      std::cout << "Evictions:\t"    << evictions_ << "\n";
+      std::cout << "Region Size:\t"  << (1UL << regionBits_) << "\n";
+      std::cout << "Edges Tracked:\t" << edges_.size() << "\n\n";
+
+      std::cout << std::setw(20) << std::left << "Evictor Region"
+        << std::setw(20) << "Victim Region"
+        << std::setw(12) << "Evictions"
+        << std::setw(10) << "Error";
+      std::cout << std::setfill('*') << std::setw(63) << "\n" << std::setfill(' ');
+      std::cout << "\n";
+      // ranked by the evictions each edge is guaranteed to have had
+      std::vector<std::pair<RegionPair, Counter> > edges(edges_.begin(),
+          edges_.end());
+      std::sort(edges.begin(), edges.end(),
+          [](const std::pair<RegionPair, Counter> &a,
+            const std::pair<RegionPair, Counter> &b) {
+            unsigned long guaranteedA = a.second.count - a.second.error;
+            unsigned long guaranteedB = b.second.count - b.second.error;
+            return guaranteedA > guaranteedB || (guaranteedA == guaranteedB
+                && a.first < b.first);
+          });
+      for (size_t i = 0; i < edges.size() && i < shown; ++i) {
+        std::cout << "0x" << std::setw(18) << std::hex
+          << (edges[i].first.first << regionBits_)
+          << "0x" << std::setw(18) << (edges[i].first.second << regionBits_)
+          << std::dec << std::setw(12) << edges[i].second.count
+          << std::setw(10) << edges[i].second.error << "\n";
+      }
+
+      // the sets with the most evictions
+      std::vector<std::pair<unsigned long, unsigned long> > sets;
+      for (size_t i = 0; i < evictionsPerSet_.size(); ++i) {
+        if (evictionsPerSet_[i] > 0) {
+          sets.push_back(std::make_pair(evictionsPerSet_[i], i));
         }
+      }
+      std::sort(sets.begin(), sets.end(),
+          [](const std::pair<unsigned long, unsigned long> &a,
+            const std::pair<unsigned long, unsigned long> &b) {
+            return a.first > b.first || (a.first == b.first && a.second < b.second);
+          });
+      std::cout << "\n";
+      std::cout << "Sets With Evictions:\t" << sets.size() << " of "
+        << evictionsPerSet_.size() << "\n";
+      std::cout << "Mean Per Set:\t" << std::setprecision(5)
+        << (double)evictions_ / evictionsPerSet_.size() << "\n\n";
+      std::cout << std::setw(10) << "Set"
+        << std::setw(12) << "Evictions";
+      std::cout << std::setfill('*') << std::setw(23) << "\n" << std::setfill(' ');
+      std::cout << "\n";
+      for (size_t i = 0; i < sets.size() && i < shown; ++i) {
+        std::cout << std::setw(10) << sets[i].second
+          << std::setw(12) << sets[i].first << "\n";
+      }
+    }
 
-        // grab the size and convert to an int
-        size = atoi((*(++token)).c_str());
+  private:
 
-        // grab address and convert to unsigned long
-        address = strtoul((*(++token)).c_str(), NULL, 16);
+    // evictor region, victim region
+    typedef std::pair<unsigned long, unsigned long> RegionPair;
 
+    struct Counter {
+      unsigned long
+        count,
+        error;
+    };
 
-        // create & configure new MemRef based on info that was just read
-        MemRef *memRef = new MemRef(refNum, rW, size, address);
-        memRef->calculate_tag(indexSize_, offsetSize_);
-        memRef->calculate_index(indexMask_, offsetSize_);
-        memRef->calculate_offset(offsetMask_);
-        //memRef->setNewTag(memRef->getTag());
+    size_t
+      capacity_;
 
-        // set hit or miss for memRef based on return from determine function
-        memRef->setHM(determine_hit_or_miss(memRef->getIndex(), memRef->getTag()));
-        memRef_.push_back(*memRef); 
+    unsigned long
+      regionBits_,
+      evictions_ = 0;
 
-        refNum++;
-        totalAccess++;
-      }
-    }
+    std::vector<unsigned long>
+      evictionsPerSet_;
 
+    std::map<RegionPair, Counter>
+      edges_;
 
-    // determine whether the mem reference was a hit or miss
-    bool determine_hit_or_miss(unsigned long index, unsigned long tag) {
-      // iterate through all cacheSets and
-      // compare memRef index to cache lines index
+    // the same edges ordered by count, smallest first
+    std::set<std::pair<unsigned long, RegionPair> >
+      byCount_;
 
-      for (std::vector<CacheSet>::iterator it = cacheSet_.begin(); 
-          it != cacheSet_.end(); ++it) {
+}; // end class ConflictGraph
+
+
+// reads little-endian values from a buffer that may not be aligned for them
+template <typename T>
+T load(const uint8_t *p) {
+  T value;
+  memcpy(&value, p, sizeof(T));
+  return value;
+}
+
+class FlatTable {
+
+  /* a read-only view of one table in a flatbuffer, enough to walk Arrow's
+  metadata. fields are looked up by id through the table's vtable, and a
+  missing field reads as its default */
+
+  public:
+
+    FlatTable(const uint8_t *table = NULL) : table_(table) {}
+
+    // the root table of the flatbuffer starting at buffer
+    static FlatTable root(const uint8_t *buffer) {
+      return FlatTable(buffer + load<uint32_t>(buffer));
+    }
+
+    bool exists() const {
+      return table_ != NULL;
+    }
+
+    // the field's position, or NULL if it is absent
+    const uint8_t *field(int id) const {
+      if (table_ == NULL) {
+        return NULL;
+      }
+      const uint8_t *vtable = table_ - load<int32_t>(table_);
+      if (4 + 2 * id >= load<uint16_t>(vtable)) {
+        return NULL;
+      }
+      uint16_t offset = load<uint16_t>(vtable + 4 + 2 * id);
+      return offset == 0 ? NULL : table_ + offset;
+    }
+
+    template <typename T>
+    T scalar(int id, T fallback) const {
+      const uint8_t *p = field(id);
+      return p == NULL ? fallback : load<T>(p);
+    }
+
+    FlatTable table(int id) const {
+      const uint8_t *p = field(id);
+      return FlatTable(p == NULL ? NULL : p + load<uint32_t>(p));
+    }
+
+    // the elements of a vector field, setting count
+    const uint8_t *vector(int id, uint32_t &count) const {
+      const uint8_t *p = field(id);
+      if (p == NULL) {
+        count = 0;
+        return NULL;
+      }
+      const uint8_t *v = p + load<uint32_t>(p);
+      count = load<uint32_t>(v);
+      return v + 4;
+    }
+
+    // element k of a vector of tables
+    FlatTable table_at(int id, uint32_t k) const {
+      uint32_t count = 0;
+      const uint8_t *elements = vector(id, count);
+      const uint8_t *p = elements + 4 * k;
+      return FlatTable(k < count ? p + load<uint32_t>(p) : NULL);
+    }
+
+    std::string string(int id) const {
+      uint32_t length = 0;
+      const uint8_t *chars = vector(id, length);
+      return chars == NULL ? "" : std::string((const char*)chars, length);
+    }
+
+  private:
+
+    const uint8_t
+      *table_;
+
+}; // end class FlatTable
+
+
+class FlatBuilder {
+
+  /* writes a flatbuffer front to back. a table is written before the
+  tables, vectors and strings it refers to, and link() fills in each
+  reference once its target has been written, since references may only
+  point forwards */
+
+  public:
+
+    // a scalar field, or a reference to fill in later. size 0 leaves the
+    // field out
+    struct Field {
+      size_t
+        size;
+
+      uint64_t
+        value;
+    };
+
+    FlatBuilder() : buffer_(4, 0) {}
+
+    void set_root(size_t table) {
+      link(0, table);
+    }
+
+    // writes a table holding fields in id order, setting slots to where
+    // each field was written. returns the table's position
+    size_t table(const std::vector<Field> &fields, std::vector<size_t> &slots) {
+      // the largest fields go first so that no padding is needed
+      std::vector<size_t> order(fields.size());
+      for (size_t k = 0; k < order.size(); ++k) {
+        order[k] = k;
+      }
+      std::stable_sort(order.begin(), order.end(),
+          [&fields](size_t a, size_t b) { return fields[a].size > fields[b].size; });
+      std::vector<uint16_t> offsets(fields.size(), 0);
+      size_t size = 4;
+      for (size_t k = 0; k < order.size(); ++k) {
+        const Field &field = fields[order[k]];
+        if (field.size > 0) {
+          size = (size + field.size - 1) / field.size * field.size;
+          offsets[order[k]] = size;
+          size += field.size;
+        }
+      }
+      size = (size + 3) / 4 * 4;
+
+      align(2);
+      size_t vtable = buffer_.size();
+      put<uint16_t>(4 + 2 * fields.size());
+      put<uint16_t>(size);
+      for (size_t k = 0; k < fields.size(); ++k) {
+        put<uint16_t>(offsets[k]);
+      }
+      align(8);
+      size_t table = buffer_.size();
+      buffer_.resize(table + size, 0);
+      patch<int32_t>(table, table - vtable);
+
+      slots.assign(fields.size(), 0);
+      for (size_t k = 0; k < fields.size(); ++k) {
+        if (offsets[k] != 0) {
+          slots[k] = table + offsets[k];
+          memcpy(&buffer_[slots[k]], &fields[k].value, fields[k].size);
+        }
+      }
+      return table;
+    }
+
+    size_t string(const std::string &value) {
+      align(4);
+      size_t position = put<uint32_t>(value.size());
+      buffer_.insert(buffer_.end(), value.begin(), value.end());
+      buffer_.push_back(0);
+      return position;
+    }
+
+    // writes the length of a vector, leaving room for its elements, and
+    // sets elements to where they start. returns the vector's position
+    size_t vector(size_t count, size_t elementSize, size_t &elements) {
+      size_t alignment = std::max(elementSize, (size_t)4);
+      while ((buffer_.size() + 4) % alignment != 0) {
+        buffer_.push_back(0);
+      }
+      size_t position = put<uint32_t>(count);
+      elements = buffer_.size();
+      buffer_.resize(elements + count * elementSize, 0);
+      return position;
+    }
+
+    // points the reference at slot to target
+    void link(size_t slot, size_t target) {
+      patch<uint32_t>(slot, target - slot);
+    }
+
+    template <typename T>
+    void patch(size_t position, T value) {
+      memcpy(&buffer_[position], &value, sizeof(T));
+    }
+
+    const std::vector<uint8_t> &get_buffer() {
+      align(8);
+      return buffer_;
+    }
+
+  private:
+
+    void align(size_t alignment) {
+      while (buffer_.size() % alignment != 0) {
+        buffer_.push_back(0);
+      }
+    }
+
+    template <typename T>
+    size_t put(T value) {
+      align(sizeof(T));
+      size_t position = buffer_.size();
+      buffer_.resize(position + sizeof(T));
+      memcpy(&buffer_[position], &value, sizeof(T));
+      return position;
+    }
+
+    std::vector<uint8_t>
+      buffer_;
+
+}; // end class FlatBuilder
+
+
+// the parts of Arrow's format used here
+namespace arrow {
+  const char magic[] = "ARROW1";
+  const uint32_t continuation = 0xFFFFFFFF;
+  const int16_t metadataV5 = 4;
+
+  // message header and field type union members
+  enum {SCHEMA_HEADER = 1, RECORD_BATCH_HEADER = 3};
+  enum {INT_TYPE = 2, UTF8_TYPE = 5, BOOL_TYPE = 6};
+}
+
+class ArrowReader {
+
+  /* reads an uncompressed Arrow IPC file (Feather version 2), mapping it
+  into memory so that columns are used in place. only flat integer, bool
+  and utf8 columns can be read */
+
+  public:
+
+    // a column's type and where its data lies in the current batch
+    struct Column {
+      int
+        type = 0,
+        bitWidth = 0;
+
+      bool
+        isSigned = false;
+
+      const uint8_t
+        *values = NULL,
+        *offsets = NULL;
+    };
+
+    ~ArrowReader() {
+      if (data_ != NULL) {
+        munmap((void*)data_, size_);
+      }
+    }
+
+    static bool is_arrow_file(const char *filename) {
+      char magic[6] = {0};
+      std::ifstream is(filename, std::ios::binary);
+      is.read(magic, sizeof(magic));
+      return is && memcmp(magic, arrow::magic, sizeof(magic)) == 0;
+    }
+
+    // maps the file and reads its schema and footer. returns 1 on error
+    int open(const char *filename) {
+      int fd = ::open(filename, O_RDONLY);
+      struct stat status;
+      if (fd < 0 || fstat(fd, &status) != 0) {
+        std::cerr << "\nError opening file: \"" << filename << "\"\n"
+          << std::endl;
+        if (fd >= 0) {
+          close(fd);
+        }
+        return 1;
+      }
+      size_ = status.st_size;
+      void *data = size_ == 0 ? MAP_FAILED
+        : mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      close(fd);
+      if (data == MAP_FAILED) {
+        return fail(filename, "cannot be mapped");
+      }
+      data_ = (const uint8_t*)data;
+
+      if (size_ < 22 || memcmp(data_ + size_ - 6, arrow::magic, 6) != 0) {
+        return fail(filename, "is not an Arrow IPC file");
+      }
+      uint32_t footerSize = load<uint32_t>(data_ + size_ - 10);
+      if (footerSize > size_ - 18) {
+        return fail(filename, "has a damaged footer");
+      }
+      footer_ = FlatTable::root(data_ + size_ - 10 - footerSize);
+
+      FlatTable schema = footer_.table(1);
+      uint32_t fieldCount = 0;
+      schema.vector(1, fieldCount);
+      for (uint32_t f = 0; f < fieldCount; ++f) {
+        FlatTable field = schema.table_at(1, f);
+        uint32_t children = 0;
+        field.vector(5, children);
+        Column column;
+        column.type = field.scalar<uint8_t>(2, 0);
+        if (column.type == arrow::INT_TYPE) {
+          FlatTable type = field.table(3);
+          column.bitWidth = type.scalar<int32_t>(0, 0);
+          column.isSigned = type.scalar<uint8_t>(1, 0);
+        } else if ((column.type != arrow::BOOL_TYPE
+              && column.type != arrow::UTF8_TYPE) || children > 0
+            || field.field(4) != NULL) {
+          // nested and dictionary encoded columns are not supported
+          column.type = 0;
+        }
+        names_.push_back(field.string(0));
+        columns_.push_back(column);
+      }
+      uint32_t count = 0;
+      footer_.vector(3, count);
+      batches_ = count;
+      return 0;
+    }
+
+    size_t get_batches() {
+      return batches_;
+    }
+
+    // the index of the named column, or -1
+    int find_column(const std::string &name) {
+      for (size_t c = 0; c < names_.size(); ++c) {
+        if (names_[c] == name) {
+          return c;
+        }
+      }
+      return -1;
+    }
+
+    Column &get_column(int c) {
+      return columns_[c];
+    }
+
+    // points the columns at batch b's data, returning its number of rows,
+    // or -1 if the batch cannot be read
+    long read_batch(size_t b) {
+      uint32_t count = 0;
+      const uint8_t *block = footer_.vector(3, count) + 24 * b;
+      uint64_t offset = load<int64_t>(block);
+      uint32_t metadataSize = load<int32_t>(block + 8);
+      uint64_t bodySize = load<int64_t>(block + 16);
+      if (offset + metadataSize + bodySize > size_) {
+        return -1;
+      }
+
+      // metadata is prefixed by its length, after a continuation marker
+      // in files written since Arrow 0.15
+      const uint8_t *metadata = data_ + offset + 4;
+      if (load<uint32_t>(data_ + offset) == arrow::continuation) {
+        metadata += 4;
+      }
+      FlatTable message = FlatTable::root(metadata);
+      FlatTable batch = message.table(2);
+      if (message.scalar<uint8_t>(1, 0) != arrow::RECORD_BATCH_HEADER
+          || batch.field(3) != NULL) {
+        // body compression is not supported
+        return -1;
+      }
+
+      const uint8_t *body = data_ + offset + metadataSize;
+      uint32_t bufferCount = 0;
+      const uint8_t *buffers = batch.vector(2, bufferCount);
+      uint32_t b2 = 0;
+      for (size_t c = 0; c < columns_.size(); ++c) {
+        Column &column = columns_[c];
+        // validity and values, plus offsets for utf8
+        int used = column.type == arrow::UTF8_TYPE ? 3 : 2;
+        if (b2 + used > bufferCount) {
+          return -1;
+        }
+        const uint8_t *values = buffers + 16 * (b2 + used - 1);
+        column.values = body + load<int64_t>(values);
+        column.offsets = column.type == arrow::UTF8_TYPE
+          ? body + load<int64_t>(buffers + 16 * (b2 + 1)) : NULL;
+        b2 += used;
+      }
+      return batch.scalar<int64_t>(0, 0);
+    }
+
+    // widens rows values of an integer column to unsigned longs. a column
+    // that already holds 64-bit values is used in place
+    const unsigned long *widen(Column &column, long rows,
+        std::vector<unsigned long> &scratch) {
+      if (column.bitWidth == 64) {
+        return (const unsigned long*)column.values;
+      }
+      scratch.resize(rows);
+      // each width gets its own loop, which the compiler can vectorize
+      switch (column.bitWidth) {
+        case 8:
+          for (long r = 0; r < rows; ++r) {
+            scratch[r] = column.isSigned ? (long)((const int8_t*)column.values)[r]
+              : ((const uint8_t*)column.values)[r];
+          }
+          break;
+        case 16:
+          for (long r = 0; r < rows; ++r) {
+            scratch[r] = column.isSigned ? (long)load<int16_t>(column.values + 2 * r)
+              : load<uint16_t>(column.values + 2 * r);
+          }
+          break;
+        case 32:
+          for (long r = 0; r < rows; ++r) {
+            scratch[r] = column.isSigned ? (long)load<int32_t>(column.values + 4 * r)
+              : load<uint32_t>(column.values + 4 * r);
+          }
+          break;
+        default:
+          scratch.assign(rows, 0);
+          break;
+      }
+      return &scratch[0];
+    }
+
+  private:
+
+    int fail(const char *filename, const char *problem) {
+      std::cerr << "\nError: \"" << filename << "\" " << problem << "\n"
+        << std::endl;
+      return 1;
+    }
+
+    const uint8_t
+      *data_ = NULL;
+
+    size_t
+      size_ = 0,
+      batches_ = 0;
+
+    FlatTable
+      footer_;
+
+    std::vector<std::string>
+      names_;
+
+    std::vector<Column>
+      columns_;
+
+}; // end class ArrowReader
+
+
+class ArrowWriter {
+
+  /* writes integer and bool columns to an Arrow IPC file (Feather version
+  2) in record batches, which pandas, Polars and pyarrow read directly */
+
+  public:
+
+    struct Column {
+      std::string
+        name;
+
+      int
+        type,
+        bitWidth;
+
+      bool
+        isSigned,
+        nullable;
+    };
+
+    // writes the magic and the schema. returns 1 on error
+    int open(const char *filename, const std::vector<Column> &columns) {
+      columns_ = columns;
+      os_.open(filename, std::ios::binary | std::ios::trunc);
+      if (os_.fail()) {
+        std::cerr << "\nError opening file: \"" << filename << "\"\n"
+          << std::endl;
+        return 1;
+      }
+      os_.write(arrow::magic, 6);
+      os_.write("\0\0", 2);
+      position_ = 8;
+
+      FlatBuilder message;
+      std::vector<size_t> slots;
+      std::vector<FlatBuilder::Field> fields = {{2, (uint64_t)arrow::metadataV5},
+        {1, arrow::SCHEMA_HEADER}, {4, 0}, {8, 0}};
+      message.set_root(message.table(fields, slots));
+      message.link(slots[2], build_schema(message));
+      write_message(message, std::vector<uint8_t>());
+      return 0;
+    }
+
+    // writes one record batch of rows rows. values and validity hold each
+    // column's buffers, and an empty validity buffer means no nulls
+    void write_batch(long rows, const std::vector<std::vector<uint8_t> > &values,
+        const std::vector<std::vector<uint8_t> > &validity,
+        const std::vector<long> &nullCounts) {
+      std::vector<uint8_t> body;
+      std::vector<std::pair<uint64_t, uint64_t> > buffers;
+      for (size_t c = 0; c < columns_.size(); ++c) {
+        add_buffer(body, buffers, validity[c]);
+        add_buffer(body, buffers, values[c]);
+      }
+
+      FlatBuilder message;
+      std::vector<size_t> slots;
+      std::vector<FlatBuilder::Field> fields = {{2, (uint64_t)arrow::metadataV5},
+        {1, arrow::RECORD_BATCH_HEADER}, {4, 0}, {8, body.size()}};
+      message.set_root(message.table(fields, slots));
+
+      std::vector<size_t> batchSlots;
+      std::vector<FlatBuilder::Field> batchFields = {{8, (uint64_t)rows},
+        {4, 0}, {4, 0}};
+      message.link(slots[2], message.table(batchFields, batchSlots));
+
+      size_t elements = 0;
+      message.link(batchSlots[1], message.vector(columns_.size(), 16, elements));
+      for (size_t c = 0; c < columns_.size(); ++c) {
+        message.patch<int64_t>(elements + 16 * c, rows);
+        message.patch<int64_t>(elements + 16 * c + 8, nullCounts[c]);
+      }
+      message.link(batchSlots[2], message.vector(buffers.size(), 16, elements));
+      for (size_t k = 0; k < buffers.size(); ++k) {
+        message.patch<int64_t>(elements + 16 * k, buffers[k].first);
+        message.patch<int64_t>(elements + 16 * k + 8, buffers[k].second);
+      }
+
+      Block block;
+      block.offset = position_;
+      block.metadataSize = write_message(message, body);
+      block.bodySize = body.size();
+      blocks_.push_back(block);
+    }
+
+    // writes the end of stream marker and the footer
+    int close() {
+      uint32_t endOfStream[2] = {arrow::continuation, 0};
+      os_.write((const char*)endOfStream, sizeof(endOfStream));
+
+      FlatBuilder footer;
+      std::vector<size_t> slots;
+      std::vector<FlatBuilder::Field> fields = {{2, (uint64_t)arrow::metadataV5},
+        {4, 0}, {4, 0}, {4, 0}};
+      footer.set_root(footer.table(fields, slots));
+      footer.link(slots[1], build_schema(footer));
+      size_t elements = 0;
+      footer.link(slots[2], footer.vector(0, 24, elements));
+      footer.link(slots[3], footer.vector(blocks_.size(), 24, elements));
+      for (size_t k = 0; k < blocks_.size(); ++k) {
+        footer.patch<int64_t>(elements + 24 * k, blocks_[k].offset);
+        footer.patch<int32_t>(elements + 24 * k + 8, blocks_[k].metadataSize);
+        footer.patch<int64_t>(elements + 24 * k + 16, blocks_[k].bodySize);
+      }
+      const std::vector<uint8_t> &buffer = footer.get_buffer();
+      uint32_t footerSize = buffer.size();
+      os_.write((const char*)&buffer[0], buffer.size());
+      os_.write((const char*)&footerSize, 4);
+      os_.write(arrow::magic, 6);
+      os_.close();
+      return os_.fail() ? 1 : 0;
+    }
+
+  private:
+
+    struct Block {
+      uint64_t
+        offset,
+        bodySize;
+
+      uint32_t
+        metadataSize;
+    };
+
+    size_t build_schema(FlatBuilder &builder) {
+      std::vector<size_t> slots;
+      std::vector<FlatBuilder::Field> fields = {{0, 0}, {4, 0}};
+      size_t schema = builder.table(fields, slots);
+      size_t elements = 0;
+      builder.link(slots[1], builder.vector(columns_.size(), 4, elements));
+      for (size_t c = 0; c < columns_.size(); ++c) {
+        const Column &column = columns_[c];
+        std::vector<size_t> fieldSlots;
+        std::vector<FlatBuilder::Field> fieldFields = {{4, 0},
+          {1, column.nullable}, {1, (uint64_t)column.type}, {4, 0}, {0, 0},
+          {4, 0}};
+        builder.link(elements + 4 * c, builder.table(fieldFields, fieldSlots));
+        builder.link(fieldSlots[0], builder.string(column.name));
+
+        std::vector<size_t> typeSlots;
+        std::vector<FlatBuilder::Field> typeFields;
+        if (column.type == arrow::INT_TYPE) {
+          typeFields = {{4, (uint64_t)column.bitWidth}, {1, column.isSigned}};
+        }
+        builder.link(fieldSlots[3], builder.table(typeFields, typeSlots));
+        size_t children = 0;
+        builder.link(fieldSlots[5], builder.vector(0, 4, children));
+      }
+      return schema;
+    }
+
+    // writes an encapsulated message and its body, returning the size of
+    // everything before the body
+    uint32_t write_message(FlatBuilder &message, const std::vector<uint8_t> &body) {
+      const std::vector<uint8_t> &buffer = message.get_buffer();
+      uint32_t prefix[2] = {arrow::continuation, (uint32_t)buffer.size()};
+      os_.write((const char*)prefix, sizeof(prefix));
+      os_.write((const char*)&buffer[0], buffer.size());
+      if (!body.empty()) {
+        os_.write((const char*)&body[0], body.size());
+      }
+      position_ += sizeof(prefix) + buffer.size() + body.size();
+      return sizeof(prefix) + buffer.size();
+    }
+
+    // appends a buffer to a body, padded to 8 bytes
+    static void add_buffer(std::vector<uint8_t> &body,
+        std::vector<std::pair<uint64_t, uint64_t> > &buffers,
+        const std::vector<uint8_t> &buffer) {
+      buffers.push_back(std::make_pair(body.size(), buffer.size()));
+      body.insert(body.end(), buffer.begin(), buffer.end());
+      body.resize((body.size() + 7) / 8 * 8, 0);
+    }
+
+    std::vector<Column>
+      columns_;
+
+    std::ofstream
+      os_;
+
+    uint64_t
+      position_ = 0;
+
+    std::vector<Block>
+      blocks_;
+
+}; // end class ArrowWriter
+
+
+class PolicyPlugin {
+
+  /* a replacement policy loaded from a shared library, as described in
+  cacheSimPlugin.h. hits, fills and invalidations are queued and handed
+  over in batches; only victim selection is called as it happens, after
+  the queue has been delivered */
+
+  public:
+
+    ~PolicyPlugin() {
+      if (policy_ != NULL) {
+        deliver();
+        if (policy_->destroy != NULL) {
+          policy_->destroy(state_);
+        }
+      }
+      if (handle_ != NULL) {
+        dlclose(handle_);
+      }
+    }
+
+    // returns 1 if the library cannot be loaded or is not a policy
+    int load(const char *path, const char *args, int sets, int ways) {
+      handle_ = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+      if (handle_ == NULL) {
+        std::cerr << "\nError loading plugin: \"" << dlerror() << "\"\n"
+          << std::endl;
+        return 1;
+      }
+      cachesim_policy_entry entry = (cachesim_policy_entry)dlsym(handle_,
+          CACHESIM_POLICY_ENTRY);
+      const cachesim_policy *policy = entry == NULL ? NULL : entry();
+      if (policy == NULL || policy->abi_version != CACHESIM_PLUGIN_ABI_VERSION
+          || policy->update == NULL || policy->victim == NULL) {
+        std::cerr << "\nError: not a version " << CACHESIM_PLUGIN_ABI_VERSION
+          << " policy plugin: \"" << path << "\"\n" << std::endl;
+        return 1;
+      }
+      policy_ = policy;
+      stride_ = policy_->set_metadata_bytes
+        + (size_t)ways * policy_->way_metadata_bytes;
+      metadata_.assign(sets * stride_, 0);
+      batch_.reserve(batchSize_);
+      if (policy_->create != NULL) {
+        state_ = policy_->create(sets, ways, args == NULL ? "" : args);
+      }
+      return 0;
+    }
+
+    const char *get_name() {
+      return policy_->name == NULL ? "" : policy_->name;
+    }
+
+    void hit(unsigned long set, int way, unsigned long tag) {
+      queue(set, way, tag, CACHESIM_HIT);
+    }
+
+    void fill(unsigned long set, int way, unsigned long tag) {
+      queue(set, way, tag, CACHESIM_FILL);
+    }
+
+    void invalidate(unsigned long set, int way, unsigned long tag) {
+      queue(set, way, tag, CACHESIM_INVALIDATE);
+    }
+
+    // asks the policy which way of a full set to evict
+    int victim(unsigned long set, std::vector<CacheLine> &lines) {
+      deliver();
+      tags_.resize(lines.size());
+      for (size_t way = 0; way < lines.size(); ++way) {
+        tags_[way] = lines[way].getTag();
+      }
+      uint8_t *setMetadata = metadata_.empty() ? NULL
+        : &metadata_[set * stride_];
+      uint32_t way = policy_->victim(state_, setMetadata, set, &tags_[0],
+          lines.size());
+      // an out of range answer still has to evict something
+      return way % lines.size();
+    }
+
+    // the cache was flushed
+    void reset() {
+      deliver();
+      std::fill(metadata_.begin(), metadata_.end(), 0);
+      if (policy_->reset != NULL) {
+        policy_->reset(state_);
+      }
+    }
+
+    // hands the queued events to the policy
+    void deliver() {
+      if (batch_.empty()) {
+        return;
+      }
+      policy_->update(state_, metadata_.empty() ? NULL : &metadata_[0],
+          &batch_[0], batch_.size());
+      batch_.clear();
+    }
+
+  private:
+
+    void queue(unsigned long set, int way, unsigned long tag,
+        cachesim_event_kind kind) {
+      cachesim_event event;
+      event.tag = tag;
+      event.set = set;
+      event.way = way;
+      event.kind = kind;
+      batch_.push_back(event);
+      if (batch_.size() >= batchSize_) {
+        deliver();
+      }
+    }
+
+    void
+      *handle_ = NULL,
+      *state_ = NULL;
+
+    const cachesim_policy
+      *policy_ = NULL;
+
+    // bytes of metadata per set
+    size_t
+      stride_ = 0,
+      batchSize_ = 4096;
+
+    std::vector<uint8_t>
+      metadata_;
+
+    std::vector<cachesim_event>
+      batch_;
+
+    std::vector<uint64_t>
+      tags_;
+
+}; // end class PolicyPlugin
+
+
+class CacheTable
+{
+  /* the main cache table that stores the sets and lines */
+
+  public:
+
+    CacheTable(){}
+
+    ~CacheTable() {
+      delete pageTable_;
+      delete conflictGraph_;
+      delete plugin_;
+      for (std::vector<CacheTable*>::iterator it = lowerLevels_.begin();
+          it != lowerLevels_.end(); ++it) {
+        delete *it;
+      }
+    }
+
+    // parameterized constructor
+    CacheTable 
+      (int totalCacheSize, int lineSize, int setSize) 
+      : totalCacheSize_(totalCacheSize), lineSize_(lineSize), 
+      setSize_(setSize) {}
+
+    void print_configuration() {
+      std::cout << std::dec
+        << "\nTotal Cache Size:  " << get_total_cache_size() << "B"
+        << "\nLine Size:  " << get_line_size() << "B"
+        << "\nSet Size:  " << get_set_size()
+        << "\nNumber of Sets:  " << get_number_of_sets() << "\n"
+        << std::endl;
+    }
+
+    // printReferences false leaves out the per-reference report
+    int print_summary(bool printReferences = true) {
+      print_configuration();
+
+      // much of this formatting is from Dr. Hughes supplement
+
+      if (printReferences) {
+        std::cout << std::setw(8)  << std::left << "RefNum";
+        std::cout << std::setw(10) << std::left << "  R/W";
+        std::cout << std::setw(13) << std::left << "Address";
+        std::cout << std::setw(6)  << std::left << "Tag";
+        std::cout << std::setw(8)  << std::left << "Index";
+        std::cout << std::setw(10) << std::left << "Offset";
+        std::cout << std::setw(8)  << std::left << "H/M";
+        std::cout << std::setfill('*') << std::setw(64) << "\n" << std::setfill(' ');
+        std::cout << "\n";
+      }
+
+      if (printReferences) {
+        print_references();
+      }
+
+      // cast as doubles for division
+      hitRate = (double)(totalHits) / (double)totalAccess;
+      missRate = (double)totalMiss / (double)totalAccess;
+
+      std::cout << "\n";
+      std::cout << "    Simulation Summary\n";
+      std::cout << "**************************\n";
+      std::cout << "Total Hits:\t"   << (totalHits) << "\n";
+      std::cout << "Total Misses:\t" << totalMiss << "\n";
+      std::cout << "Hit Rate:\t"     << std::setprecision(5) << hitRate   << "\n";
+      std::cout << "Miss Rate:\t"    << std::setprecision(5) << missRate  << "\n";
+      if (insertionPolicy_ == InsertionPolicy::DIP) {
+        std::cout << "Final PSEL:\t"  << psel_ << "\n";
+      }
+      if (!engineChoice_.empty()) {
+        std::cout << "Engine:\t\t" << engineChoice_ << "\n";
+      }
+      if (writeCombining_ > 0) {
+        std::cout << "Writes Combined:\t" << writesCombined_ << " of "
+          << writesSeen_ << "\n";
+      }
+      if (pageTable_ != NULL) {
+        std::cout << "Pages Mapped:\t" << pageTable_->get_pages_mapped() << "\n";
+        if (pageTable_->get_frames_reused() > 0) {
+          std::cout << "Frames Reused:\t" << pageTable_->get_frames_reused()
+            << "\n";
+        }
+      }
+
+      if (!lowerLevels_.empty()) {
+        print_hierarchy_summary();
+      }
+      if (conflictGraph_ != NULL) {
+        conflictGraph_->print_summary(conflictsShown_);
+      }
+      return 0;
+    }
+
+    // prints one row per reference. the rows are formatted in chunks on
+    // one thread per CPU, and each round of chunks is written out in order
+    void print_references() {
+      const size_t chunkRows = 1 << 15;
+      size_t chunks = (memRef_.size() + chunkRows - 1) / chunkRows;
+      size_t threads = std::max(1u, std::thread::hardware_concurrency());
+      threads = std::min(threads, chunks);
+      std::vector<std::string> buffers(threads);
+
+      for (size_t round = 0; round < chunks; round += threads) {
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads && round + t < chunks; ++t) {
+          workers.push_back(std::thread([this, &buffers, round, t]() {
+            size_t first = (round + t) * chunkRows;
+            size_t last = std::min(first + chunkRows, memRef_.size());
+            std::string &buffer = buffers[t];
+            buffer.clear();
+            char row[160];
+            for (size_t i = first; i < last; ++i) {
+              buffer.append(row, format_reference(memRef_[i], row,
+                    sizeof(row)));
+            }
+          }));
+        }
+        for (size_t t = 0; t < workers.size(); ++t) {
+          workers[t].join();
+          std::cout.write(buffers[t].data(), buffers[t].size());
+        }
+      }
+      std::cout.flush();
+    }
+
+    // formats a reference's row into row, which holds size bytes, and
+    // returns its length. the row matches what the stream formatting of
+    // the table's columns produced: left aligned number and op, then
+    // right aligned columns
+    static size_t format_reference(MemRef &memRef, char *row, size_t size) {
+      const char *op = " ASID";
+      if (memRef.getRW() == ReadOrWrite::READ) {
+        op = " Read";
+      } else if (memRef.getRW() == ReadOrWrite::WRITE) {
+        op = "Write";
+      } else if (memRef.getRW() == ReadOrWrite::INVALIDATE) {
+        op = "Inval";
+      } else if (memRef.getRW() == ReadOrWrite::FLUSH) {
+        op = "Flush";
+      }
+      const char *hM = !memRef.is_access() ? "-"
+        : memRef.getHM() ? "Hit" : "Miss";
+      int length = snprintf(row, size, "   %-5d%-8s  %08lx%7lx%8d%8d%10s\n",
+          memRef.getRefNum(), op, memRef.getAddress(), memRef.getTag(),
+          memRef.getIndex(), memRef.getOffset(), hM);
+      return std::min((size_t)length, size - 1);
+    }
+
+    void increment_number_of_sets() {
+      numberOfSets_++;
+    }
+
+    void calculate_number_of_sets() {
+      // make sure lineSize_ > 0
+      if ((lineSize_ != 0) && (setSize_ != 0)) {
+        numberOfSets_ = (totalCacheSize_ / lineSize_) / setSize_;
+      }
+    }
+
+    // these calculate the dimensions of various cache properties
+    void calculate_index_size() {
+      indexSize_ = log2(numberOfSets_);
+    }
+
+    void calculate_offset_size() {
+      offsetSize_ = log2(lineSize_);
+    }
+
+    void calculate_tag_size() {
+      tagSize_ = (lineSize_ * 8) - indexSize_ - offsetSize_;
+    }
+
+    void calculate_offset_mask() {
+      offsetMask_ = pow(2, offsetSize_) - 1;
+    }
+
+    void calculate_index_mask() {
+      indexMask_ = (pow(2, (indexSize_ + offsetSize_)) - 1) - offsetMask_;
+    }
+
+    void calculate_tag_mask() {
+      tagMask_ = pow(2, (lineSize_ * 8)) - 1 - indexMask_ - offsetMask_;
+    }
+
+    // reads a configuration file and derives the cache geometry from it
+    int configure(char* filename) {
+      if (read_cache_config(filename) != 0) {
+        return 1;
+      }
+      calculate_geometry();
+      return 0;
+    }
+
+    // configures the cache from its associativity, line size and total
+    // size instead of a file
+    void configure(int setSize, int lineSize, int totalCacheSize) {
+      setSize_ = setSize;
+      lineSize_ = lineSize;
+      totalCacheSize_ = totalCacheSize;
+      calculate_geometry();
+    }
+
+    void calculate_geometry() {
+      calculate_number_of_sets();
+      create_cache_sets(get_number_of_sets());
+      set_index_for_cache_sets();
+      calculate_index_size();
+      calculate_offset_size();
+      calculate_tag_size();
+      calculate_offset_mask();
+      calculate_index_mask();
+      calculate_tag_mask();
+    }
+
+    // reads the cache configuration files
+    int read_cache_config(char* filename) {
+      // open the input file
+      std::ifstream is;
+      // read first file
+      is.open(filename, std::ios::in);
+      // return 1 if file not found
+      if (is.fail()) {
+        std::cerr << "\nError opening file: \"" << filename 
+          << "\"\n" << std::endl;
+        return 1;
+      }
+      is >> setSize_;
+      is >> lineSize_;
+      is >> totalCacheSize_;
+
+      is.close();
+      return 0;
+    }
+
+    // reads the memory trace and runs it against the cache
+    int read_mem_trace(char* filename) {
+      if (decode_mem_trace(filename) != 0) {
+        return 1;
+      }
+
+      if (autoEngine_) {
+        select_engine();
+      }
+
+      // run the decoded references against the cache
+      simulate_mem_refs();
+      return 0;
+    }
+
+    // reads the basic block table of an instruction trace. each line is
+    // <id>:<length>:<hexaddress>, giving the block's length in bytes and
+    // its start address
+    int read_block_table(char* filename) {
+      std::ifstream is;
+      std::string input;
+      is.open(filename, std::ios::in);
+      if (is.fail()) {
+        std::cerr << "\nError opening file: \"" << filename
+          << "\"\n" << std::endl;
+        return 1;
+      }
+      blockTableStamp_ = file_stamp(filename);
+      boost::char_separator<char> delimeter(": \t\r");
+      while (std::getline(is, input)) {
+        Tokens tokens(input, delimeter);
+        std::vector<std::string> fields(tokens.begin(), tokens.end());
+        if (fields.size() < 3) {
+          continue;
+        }
+        BasicBlock &block = basicBlocks_[strtoul(fields[0].c_str(), NULL, 0)];
+        block.length = strtoul(fields[1].c_str(), NULL, 0);
+        block.start = strtoul(fields[2].c_str(), NULL, 16);
+      }
+      return 0;
+    }
+
+    // decodes the trace, or with a shared trace cache, attaches to the
+    // decoded references another run published for the same trace and
+    // settings, or publishes them for the next run
+    int decode_mem_trace(char* filename) {
+      if (!sharedTrace_) {
+        return decode_trace_file(filename);
+      }
+      std::string key = shared_trace_key(filename);
+      if (!key.empty() && attach_shared_trace(key) == 0) {
+        return 0;
+      }
+      if (decode_trace_file(filename) != 0) {
+        return 1;
+      }
+      if (!key.empty()) {
+        publish_shared_trace(key);
+      }
+      return 0;
+    }
+
+    // keeps decoded traces in POSIX shared memory across runs
+    void set_shared_trace() {
+      sharedTrace_ = true;
+    }
+
+    // identifies a file's contents by its device, inode, size and
+    // modification time. empty if the file cannot be read
+    static std::string file_stamp(const char *filename) {
+      struct stat status;
+      if (stat(filename, &status) != 0) {
+        return "";
+      }
+      return std::to_string(status.st_dev) + ":"
+        + std::to_string(status.st_ino) + ":"
+        + std::to_string(status.st_size) + ":"
+        + std::to_string(status.st_mtim.tv_sec) + "."
+        + std::to_string(status.st_mtim.tv_nsec);
+    }
+
+    // the trace's fingerprint together with everything that changes how it
+    // decodes. empty if the trace cannot be read
+    std::string shared_trace_key(const char *filename) {
+      std::string stamp = file_stamp(filename);
+      if (stamp.empty()) {
+        return "";
+      }
+      return stamp + "/" + std::to_string(lineSize_) + "/"
+        + std::to_string(numberOfSets_) + "/" + std::to_string(writeCombining_)
+        + "/" + blockTableStamp_ + "/" + std::to_string(sizeof(MemRef));
+    }
+
+    // the segment name for a key, from its 64-bit FNV-1a hash
+    static std::string shared_trace_name(const std::string &key) {
+      uint64_t hash = 14695981039346656037ULL;
+      for (size_t c = 0; c < key.size(); ++c) {
+        hash = (hash ^ (unsigned char)key[c]) * 1099511628211ULL;
+      }
+      char name[32];
+      snprintf(name, sizeof(name), "/cacheSim-%016lx", (unsigned long)hash);
+      return name;
+    }
+
+    // copies the references of a complete segment for key into memRef_.
+    // returns 1 if there is none
+    int attach_shared_trace(const std::string &key) {
+      std::string name = shared_trace_name(key);
+      int fd = shm_open(name.c_str(), O_RDONLY, 0);
+      struct stat status;
+      if (fd < 0) {
+        return 1;
+      }
+      // segment names are predictable, so one another user left is ignored
+      if (fstat(fd, &status) != 0 || status.st_uid != geteuid()
+          || (size_t)status.st_size < sizeof(SharedTraceHeader)) {
+        close(fd);
+        return 1;
+      }
+      size_t size = status.st_size;
+      void *data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+      close(fd);
+      if (data == MAP_FAILED) {
+        return 1;
+      }
+
+      // a segment that was never finished, or one for a colliding key, is
+      // not used, and the run that decodes the trace replaces it
+      const SharedTraceHeader *header = (const SharedTraceHeader*)data;
+      if (__atomic_load_n(&header->ready, __ATOMIC_ACQUIRE) != 1
+          || key.compare(header->key) != 0
+          || sizeof(SharedTraceHeader) + header->count * sizeof(MemRef) > size) {
+        munmap(data, size);
+        return 1;
+      }
+      const MemRef *records = (const MemRef*)(header + 1);
+      memRef_.assign(records, records + header->count);
+      writesSeen_ = header->writesSeen;
+      writesCombined_ = header->writesCombined;
+      munmap(data, size);
+
+      for (std::vector<MemRef>::iterator it = memRef_.begin();
+          it != memRef_.end(); ++it) {
+        if (it->is_access()) {
+          totalAccess++;
+        }
+      }
+      if (!memRef_.empty()) {
+        decodeAsid_ = memRef_.back().getAsid();
+      }
+      return 0;
+    }
+
+    // copies memRef_ into a new segment for key. the segment is filled
+    // under a name of its own and renamed into place once it is ready, so
+    // readers never see a partial segment, and one left half written by a
+    // killed run or published for a colliding key is simply replaced.
+    // nothing is done if shared memory is unavailable
+    void publish_shared_trace(const std::string &key) {
+      if (key.size() >= sizeof(((SharedTraceHeader*)0)->key)) {
+        return;
+      }
+      std::string name = shared_trace_name(key);
+      std::string building = name + "-" + std::to_string(getpid());
+      // a segment left by an earlier run with the same pid is stale
+      shm_unlink(building.c_str());
+      int fd = shm_open(building.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+      if (fd < 0) {
+        return;
+      }
+      size_t size = sizeof(SharedTraceHeader) + memRef_.size() * sizeof(MemRef);
+      void *data = ftruncate(fd, size) != 0 ? MAP_FAILED
+        : mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      close(fd);
+      if (data == MAP_FAILED) {
+        shm_unlink(building.c_str());
+        return;
+      }
+      // huge pages, where tmpfs allows them, make attaching cheaper
+      madvise(data, size, MADV_HUGEPAGE);
+
+      SharedTraceHeader *header = (SharedTraceHeader*)data;
+      strcpy(header->key, key.c_str());
+      header->count = memRef_.size();
+      header->writesSeen = writesSeen_;
+      header->writesCombined = writesCombined_;
+      memcpy((void*)(header + 1), (const void*)memRef_.data(),
+          memRef_.size() * sizeof(MemRef));
+      __atomic_store_n(&header->ready, 1, __ATOMIC_RELEASE);
+      munmap(data, size);
+
+      // shm_open names are files in /dev/shm on Linux, and rename replaces
+      // the target atomically. readers attached to an old segment keep it
+      std::string directory = "/dev/shm";
+      if (rename((directory + building).c_str(),
+            (directory + name).c_str()) != 0) {
+        shm_unlink(building.c_str());
+      }
+    }
+
+    // reads and parses the memory trace files 
+    int decode_trace_file(char* filename) {
+      /* The memory trace should have the format: 
+         <accesstype>:<size>:<hexaddress>
+         where accesstype is R, W, or I to invalidate the line. a line
+         holding just F flushes the whole cache, and A:<asid> switches
+         address spaces. with a block table, B:<id> fetches a basic block.
+         Arrow files and the binary traces of cacheTraceEmitter.hpp are
+         recognized by their magic bytes
+         */
+      if (ArrowReader::is_arrow_file(filename)) {
+        return decode_arrow_trace(filename);
+      }
+      if (is_emitted_trace(filename)) {
+        return decode_emitted_trace(filename);
+      }
+
+      // open the input file
+      std::ifstream is;
+      std::string input;
+      // read first file
+      is.open(filename, std::ios::in); // input stream
+      // return 1 if file not found
+      if (is.fail()) {
+        std::cerr << "\nError opening file: \"" << filename 
+          << "\"\n" << std::endl;
+        return 1;
+      }
+      // clearing the whitespace seemed necessary for the getline
+        std::ws(is);
+      while (std::getline(is, input)) {
+
+        std::ws(is);
+        if (parse_trace_line(input) != 0) {
+          return 1;
+        }
+      }
+      drain_write_buffers();
+      if (unknownBlocks_ > 0) {
+        std::cerr << "\nWarning: skipped " << unknownBlocks_
+          << " fetches of blocks missing from the block table\n" << std::endl;
+      }
+      return 0;
+    }
+
+    // decodes one line of a text trace. an unknown op letter repeats the
+    // previous record's op. returns 1 if the line names an invalid core
+    int parse_trace_line(const std::string &line) {
+      // leading whitespace is skipped, as the stream does between lines
+      size_t first = line.find_first_not_of(" \t\r\n\v\f");
+      if (first == std::string::npos) {
+        return 0;
+      }
+      std::string input = line.substr(first);
+
+      // define delimeters
+      boost::char_separator<char> delimeter(":");
+
+      // tokenize string according to delimeter
+      Tokens tokens(input, delimeter);
+
+      // iterate through tokens
+      Tokens::iterator token = tokens.begin();
+      if (token == tokens.end()) {
+        return 0;
+      }
+      ReadOrWrite &rW = decodeRW_;
+      int size = 0;
+      unsigned long address = 0;
+      int core = 0;
+      if (*token == "F") {
+        rW = ReadOrWrite::FLUSH;
+      } else if (*token == "M") {
+        // a fence drains the write-combining buffers and adds no record
+        drain_write_buffers();
+        return 0;
+      } else if (*token == "B") {
+        // a basic block fetch expands into its instruction lines
+        rW = ReadOrWrite::READ;
+        if (++token != tokens.end()) {
+          unsigned long id = strtoul((*token).c_str(), NULL, 0);
+          if (++token != tokens.end()
+              && (core = parse_core(*token, input)) < 0) {
+            return 1;
+          }
+          append_basic_block(id, core);
+        }
+        return 0;
+      } else if (*token == "A") {
+        // the new address space id takes the place of the address
+        rW = ReadOrWrite::SWITCH;
+        if (++token != tokens.end()) {
+          address = strtoul((*token).c_str(), NULL, 0);
+        }
+      } else {
+        if (*token == "R") {
+          rW = ReadOrWrite::READ;
+        } 
+        else if (*token == "W") {
+          rW = ReadOrWrite::WRITE;
+        }
+        else if (*token == "I") {
+          rW = ReadOrWrite::INVALIDATE;
+        }
+
+        // grab the size and convert to an int
+        if (++token != tokens.end()) {
+          size = atoi((*token).c_str());
+        }
+
+        // grab address and convert to unsigned long
+        if (token != tokens.end() && ++token != tokens.end()) {
+          address = strtoul((*token).c_str(), NULL, 16);
+        }
+
+        // an optional fourth field names the core that made the reference
+        if (token != tokens.end() && ++token != tokens.end()
+            && (core = parse_core(*token, input)) < 0) {
+          return 1;
+        }
+      }
+
+      append_mem_ref(rW, size, address, core);
+      return 0;
+    }
+
+    // the core named by a text trace field, a decimal number below
+    // MAX_CORES. reports the line and returns -1 otherwise
+    static int parse_core(const std::string &field, const std::string &line) {
+      const char *text = field.c_str();
+      char *end = NULL;
+      errno = 0;
+      long core = strtol(text, &end, 10);
+      while (end != text && isspace((unsigned char)*end)) {
+        end++;
+      }
+      if (end == text || *end != '\0' || errno != 0 || core < 0
+          || core >= MAX_CORES) {
+        std::cerr << "\nError: invalid core \"" << field << "\" in trace line \""
+          << line << "\"\n" << std::endl;
+        return -1;
+      }
+      return core;
+    }
+
+    // simulates a text trace as it grows, like tail -f. inotify reports
+    // each append, and the new complete lines are simulated serially and
+    // then dropped, so memory stays bounded. cumulative results are printed
+    // every interval seconds. returns when the file is deleted or replaced,
+    // or on SIGINT. a file truncated in place is read from the start
+    int follow_mem_trace(char* filename, double interval) {
+      std::ifstream is(filename, std::ios::in);
+      if (is.fail()) {
+        std::cerr << "\nError opening file: \"" << filename
+          << "\"\n" << std::endl;
+        return 1;
+      }
+      // unlinking the file only shows up as a change to its link count,
+      // since the open stream keeps it alive
+      struct stat followed;
+      int inotify = inotify_init1(IN_CLOEXEC);
+      if (stat(filename, &followed) != 0 || inotify < 0
+          || inotify_add_watch(inotify, filename, IN_MODIFY | IN_CLOSE_WRITE
+            | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF) < 0) {
+        std::cerr << "\nError watching file: \"" << filename
+          << "\"\n" << std::endl;
+        if (inotify >= 0) {
+          close(inotify);
+        }
+        return 1;
+      }
+
+      // SIGINT interrupts poll() instead of restarting it
+      struct sigaction action;
+      memset(&action, 0, sizeof(action));
+      action.sa_handler = stop_following;
+      sigaction(SIGINT, &action, NULL);
+
+      std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+      std::chrono::steady_clock::duration period =
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(std::max(interval, 0.001)));
+      std::chrono::steady_clock::time_point nextReport = start + period;
+      std::string pending;
+      bool watching = true;
+      while (!followStopped_) {
+        if (consume_lines(is, pending) != 0) {
+          close(inotify);
+          signal(SIGINT, SIG_DFL);
+          return 1;
+        }
+        if (!watching) {
+          break;
+        }
+
+        std::chrono::steady_clock::time_point now =
+          std::chrono::steady_clock::now();
+        if (now >= nextReport) {
+          print_follow_progress(std::chrono::duration<double>(now - start).count());
+          while (nextReport <= now) {
+            nextReport += period;
+          }
+        }
+
+        struct pollfd events = {inotify, POLLIN, 0};
+        long timeout = std::chrono::duration_cast<std::chrono::milliseconds>(
+            nextReport - now).count() + 1;
+        if (poll(&events, 1, timeout) <= 0) {
+          continue;
+        }
+        char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+        ssize_t length = read(inotify, buffer, sizeof(buffer));
+        for (ssize_t k = 0; k < length; ) {
+          const struct inotify_event *event =
+            (const struct inotify_event*)(buffer + k);
+          if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+            // read what was written before it went
+            watching = false;
+          }
+          k += sizeof(struct inotify_event) + event->len;
+        }
+
+        struct stat status;
+        if (stat(filename, &status) != 0 || status.st_ino != followed.st_ino
+            || status.st_dev != followed.st_dev) {
+          watching = false;
+        } else if (status.st_size < is.tellg()) {
+          is.clear();
+          is.seekg(0);
+          pending.clear();
+        }
+      }
+      close(inotify);
+      signal(SIGINT, SIG_DFL);
+      // the writes still held in the write-combining buffers reach the cache
+      drain_write_buffers();
+      simulate_decoded();
+      print_follow_progress(std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count());
+      return 0;
+    }
+
+    // parses the complete lines that have been appended, keeping a partial
+    // last line in pending, and simulates them. returns 1 on an invalid line
+    int consume_lines(std::ifstream &is, std::string &pending) {
+      std::string line;
+      while (std::getline(is, line)) {
+        if (is.eof()) {
+          // no newline yet, so the writer may not have finished the line
+          pending += line;
+          break;
+        }
+        if (parse_trace_line(pending + line) != 0) {
+          return 1;
+        }
+        pending.clear();
+      }
+      is.clear();
+      simulate_decoded();
+      return 0;
+    }
+
+    // simulates the records decoded since the last call and drops them
+    void simulate_decoded() {
+      for (std::vector<MemRef>::iterator it = memRef_.begin();
+          it != memRef_.end(); ++it) {
+        simulate_mem_ref(*it);
+      }
+      refNumBase_ += memRef_.size();
+      memRef_.clear();
+    }
+
+    void print_follow_progress(double elapsed) {
+      std::cout << "Elapsed: " << std::fixed << std::setprecision(1) << elapsed
+        << "s" << std::defaultfloat
+        << "\tRecords: "   << refNumBase_
+        << "\tHits: "      << totalHits
+        << "\tMisses: "    << totalMiss
+        << "\tHit Rate: "  << std::setprecision(5) << (totalAccess == 0 ? 0
+            : (double)totalHits / totalAccess) << std::endl;
+    }
+
+    // set by SIGINT to end follow mode
+    static volatile sig_atomic_t followStopped_;
+
+    static void stop_following(int) {
+      followStopped_ = 1;
+    }
+
+    // reads a trace from an Arrow IPC file with an op column holding the
+    // record's letter, as a utf8 string or its character code, an address
+    // column, and optional size and core columns
+    int decode_arrow_trace(char* filename) {
+      ArrowReader reader;
+      if (reader.open(filename) != 0) {
+        return 1;
+      }
+      int op = reader.find_column("op");
+      int address = reader.find_column("address");
+      int size = reader.find_column("size");
+      int core = reader.find_column("core");
+      int integerColumns[] = {address, size, core};
+      for (int k = 0; k < 3; ++k) {
+        if (integerColumns[k] >= 0
+            && reader.get_column(integerColumns[k]).type != arrow::INT_TYPE) {
+          integerColumns[k] = -2;
+        }
+      }
+      if (op < 0 || address < 0 || integerColumns[0] == -2
+          || integerColumns[1] == -2 || integerColumns[2] == -2
+          || (reader.get_column(op).type != arrow::INT_TYPE
+            && reader.get_column(op).type != arrow::UTF8_TYPE)) {
+        std::cerr << "\nError: \"" << filename << "\" needs integer address, "
+          << "size and core columns and an op column\n" << std::endl;
+        return 1;
+      }
+
+      std::vector<unsigned long> opScratch, addressScratch, sizeScratch,
+        coreScratch;
+      for (size_t b = 0; b < reader.get_batches(); ++b) {
+        long rows = reader.read_batch(b);
+        if (rows < 0) {
+          std::cerr << "\nError: \"" << filename << "\" has a compressed or "
+            << "damaged record batch\n" << std::endl;
+          return 1;
+        }
+        ArrowReader::Column &opColumn = reader.get_column(op);
+        const unsigned long *ops = opColumn.type == arrow::INT_TYPE
+          ? reader.widen(opColumn, rows, opScratch) : NULL;
+        const unsigned long *addresses = reader.widen(
+            reader.get_column(address), rows, addressScratch);
+        const unsigned long *sizes = size < 0 ? NULL
+          : reader.widen(reader.get_column(size), rows, sizeScratch);
+        const unsigned long *cores = core < 0 ? NULL
+          : reader.widen(reader.get_column(core), rows, coreScratch);
+
+        for (long r = 0; r < rows; ++r) {
+          // signed cores below zero widen to huge values
+          if (cores != NULL && cores[r] >= (unsigned long)MAX_CORES) {
+            std::cerr << "\nError: \"" << filename << "\" has an invalid core "
+              << (long)cores[r] << " in record batch " << b << "\n"
+              << std::endl;
+            return 1;
+          }
+          char letter = 0;
+          if (ops != NULL) {
+            letter = ops[r];
+          } else if (load<int32_t>(opColumn.offsets + 4 * r + 4)
+              > load<int32_t>(opColumn.offsets + 4 * r)) {
+            letter = opColumn.values[load<int32_t>(opColumn.offsets + 4 * r)];
+          }
+          append_mem_ref(letter, sizes == NULL ? 0 : sizes[r],
+              addresses[r], cores == NULL ? 0 : cores[r]);
+        }
+      }
+      drain_write_buffers();
+      return 0;
+    }
+
+    // the op of a record letter in the binary trace formats
+    static ReadOrWrite decode_op(char letter) {
+      if (letter == 'R') {
+        return ReadOrWrite::READ;
+      } else if (letter == 'W') {
+        return ReadOrWrite::WRITE;
+      } else if (letter == 'I') {
+        return ReadOrWrite::INVALIDATE;
+      } else if (letter == 'F') {
+        return ReadOrWrite::FLUSH;
+      } else if (letter == 'A') {
+        return ReadOrWrite::SWITCH;
+      }
+      return ReadOrWrite::ERROR;
+    }
+
+    static bool is_emitted_trace(const char *filename) {
+      char magic[sizeof(cachetrace::magic)] = {0};
+      std::ifstream is(filename, std::ios::binary);
+      is.read(magic, sizeof(magic));
+      return is && memcmp(magic, cachetrace::magic, sizeof(magic)) == 0;
+    }
+
+    // decodes a trace written by cacheTraceEmitter.hpp. each thread wrote
+    // its records in chunks, which are merged back into timestamp order.
+    // the emitting thread becomes the core
+    int decode_emitted_trace(char* filename) {
+      int fd = ::open(filename, O_RDONLY);
+      struct stat status;
+      if (fd < 0 || fstat(fd, &status) != 0) {
+        std::cerr << "\nError opening file: \"" << filename << "\"\n"
+          << std::endl;
+        if (fd >= 0) {
+          close(fd);
+        }
+        return 1;
+      }
+      size_t size = status.st_size;
+      void *data = size < sizeof(cachetrace::Header) ? MAP_FAILED
+        : mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      close(fd);
+      if (data == MAP_FAILED) {
+        std::cerr << "\nError: \"" << filename << "\" cannot be mapped\n"
+          << std::endl;
+        return 1;
+      }
+      const cachetrace::Header *header = (const cachetrace::Header*)data;
+      if (header->version != cachetrace::version
+          || header->recordSize != sizeof(cachetrace::Record)) {
+        std::cerr << "\nError: \"" << filename << "\" has an unsupported "
+          << "trace version\n" << std::endl;
+        munmap(data, size);
+        return 1;
+      }
+
+      const cachetrace::Record *records = (const cachetrace::Record*)(header + 1);
+      size_t count = (size - sizeof(cachetrace::Header))
+        / sizeof(cachetrace::Record);
+      std::vector<size_t> order(count);
+      for (size_t r = 0; r < count; ++r) {
+        order[r] = r;
+      }
+      std::stable_sort(order.begin(), order.end(),
+          [records](size_t a, size_t b) {
+            return records[a].timestamp < records[b].timestamp;
+          });
+      for (size_t r = 0; r < count; ++r) {
+        const cachetrace::Record &record = records[order[r]];
+        if (record.thread >= (uint32_t)MAX_CORES) {
+          std::cerr << "\nError: \"" << filename << "\" has a record from "
+            << "thread " << record.thread << ", more than are supported\n"
+            << std::endl;
+          munmap(data, size);
+          return 1;
+        }
+        append_mem_ref((char)record.op, record.size, record.address,
+            record.thread);
+      }
+      munmap(data, size);
+      drain_write_buffers();
+      return 0;
+    }
+
+    // writes the per-reference results to an Arrow IPC file, one record
+    // batch per batchRows references. hit is null for records that are not
+    // accesses. returns 1 on error
+    int write_arrow_results(char* filename) {
+      const size_t batchRows = 1 << 16;
+      std::vector<ArrowWriter::Column> columns = {
+        {"refnum",  arrow::INT_TYPE,  64, false, false},
+        {"op",      arrow::INT_TYPE,  8,  false, false},
+        {"size",    arrow::INT_TYPE,  32, false, false},
+        {"address", arrow::INT_TYPE,  64, false, false},
+        {"tag",     arrow::INT_TYPE,  64, false, false},
+        {"index",   arrow::INT_TYPE,  32, false, false},
+        {"offset",  arrow::INT_TYPE,  32, false, false},
+        {"core",    arrow::INT_TYPE,  32, false, false},
+        {"hit",     arrow::BOOL_TYPE, 1,  false, true}};
+      ArrowWriter writer;
+      if (writer.open(filename, columns) != 0) {
+        return 1;
+      }
+
+      const char letters[] = {'?', 'R', 'W', 'I', 'F', 'A'};
+      for (size_t first = 0; first < memRef_.size() || first == 0;
+          first += batchRows) {
+        size_t rows = std::min(batchRows, memRef_.size() - first);
+        std::vector<std::vector<uint8_t> > values(columns.size());
+        std::vector<std::vector<uint8_t> > validity(columns.size());
+        std::vector<long> nullCounts(columns.size(), 0);
+        for (size_t c = 0; c < columns.size(); ++c) {
+          values[c].assign(columns[c].type == arrow::BOOL_TYPE ? (rows + 7) / 8
+              : rows * columns[c].bitWidth / 8, 0);
+        }
+        validity[8].assign((rows + 7) / 8, 0);
+
+        for (size_t r = 0; r < rows; ++r) {
+          MemRef &memRef = memRef_[first + r];
+          uint64_t refNum = memRef.getRefNum();
+          uint64_t address = memRef.getAddress();
+          uint64_t tag = memRef.getTag();
+          uint32_t size = memRef.getSize();
+          uint32_t index = memRef.getIndex();
+          uint32_t offset = memRef.getOffset();
+          uint32_t core = memRef.getCore();
+          memcpy(&values[0][8 * r], &refNum, 8);
+          values[1][r] = letters[(int)memRef.getRW()];
+          memcpy(&values[2][4 * r], &size, 4);
+          memcpy(&values[3][8 * r], &address, 8);
+          memcpy(&values[4][8 * r], &tag, 8);
+          memcpy(&values[5][4 * r], &index, 4);
+          memcpy(&values[6][4 * r], &offset, 4);
+          memcpy(&values[7][4 * r], &core, 4);
+          if (memRef.is_access()) {
+            validity[8][r / 8] |= 1 << (r % 8);
+            if (memRef.getHM()) {
+              values[8][r / 8] |= 1 << (r % 8);
+            }
+          } else {
+            nullCounts[8]++;
+          }
+        }
+        writer.write_batch(rows, values, validity, nullCounts);
+        if (memRef_.empty()) {
+          break;
+        }
+      }
+      return writer.close();
+    }
+
+    // adds one decoded record after the ones decoded so far. for an
+    // address space switch, address holds the new address space id. with
+    // a write-combining buffer, writes wait in their core's buffer, and a
+    // write to a line already there is merged into it
+    void append_mem_ref(ReadOrWrite rW, int size, unsigned long address,
+        int core) {
+      if (writeCombining_ == 0) {
+        store_mem_ref(rW, size, address, core);
+        return;
+      }
+
+      if (rW == ReadOrWrite::WRITE) {
+        writesSeen_++;
+        if (core >= (int)writeBuffers_.size()) {
+          writeBuffers_.resize(core + 1);
+        }
+        std::vector<CombinedWrite> &buffer = writeBuffers_[core];
+        unsigned long line = address & ~offsetMask_;
+        for (size_t e = 0; e < buffer.size(); ++e) {
+          if (buffer[e].line == line) {
+            buffer[e].size = std::min(buffer[e].size + size, lineSize_);
+            writesCombined_++;
+            return;
+          }
+        }
+        // a full buffer drains its oldest entry to make room
+        if (buffer.size() == writeCombining_) {
+          store_mem_ref(ReadOrWrite::WRITE, buffer.front().size,
+              buffer.front().line, core);
+          buffer.erase(buffer.begin());
+        }
+        CombinedWrite entry = {line, std::min(size, lineSize_)};
+        buffer.push_back(entry);
+        return;
+      }
+
+      // flushes, invalidates and address space switches are fences
+      if (rW != ReadOrWrite::READ) {
+        drain_write_buffers();
+      }
+      store_mem_ref(rW, size, address, core);
+    }
+
+    // adds a record given by its trace letter. M is a fence, which only
+    // drains the write-combining buffers
+    void append_mem_ref(char letter, int size, unsigned long address,
+        int core) {
+      if (letter == 'M') {
+        drain_write_buffers();
+      } else {
+        append_mem_ref(decode_op(letter), size, address, core);
+      }
+    }
+
+    // writes every buffered write to the cache, oldest first within each
+    // core's buffer
+    void drain_write_buffers() {
+      for (size_t core = 0; core < writeBuffers_.size(); ++core) {
+        for (size_t e = 0; e < writeBuffers_[core].size(); ++e) {
+          store_mem_ref(ReadOrWrite::WRITE, writeBuffers_[core][e].size,
+              writeBuffers_[core][e].line, core);
+        }
+        writeBuffers_[core].clear();
+      }
+    }
+
+    // uses a write-combining buffer of entries lines per core in front of
+    // the cache
+    void set_write_combining(size_t entries) {
+      writeCombining_ = entries;
+    }
+
+    // writes merged into a buffered one, so they added no record
+    unsigned long get_writes_combined() {
+      return writesCombined_;
+    }
+
+    // adds a record to memRef_, after any write combining
+    void store_mem_ref(ReadOrWrite rW, int size, unsigned long address,
+        int core) {
+      if (rW == ReadOrWrite::SWITCH) {
+        decodeAsid_ = address;
+      }
+
+      // physically indexed caches see the translated address
+      if (pageTable_ != NULL && rW != ReadOrWrite::FLUSH
+          && rW != ReadOrWrite::SWITCH) {
+        address = pageTable_->translate(decodeAsid_, address);
+      }
+
+      // create & configure new MemRef based on info that was just read
+      MemRef memRef(refNumBase_ + memRef_.size(), rW, size, address);
+      memRef.setAsid(decodeAsid_);
+      memRef.setCore(core);
+      memRef.calculate_tag(indexSize_, offsetSize_);
+      memRef.calculate_index(indexMask_, offsetSize_);
+      memRef.calculate_offset(offsetMask_);
+      memRef_.push_back(memRef);
+      lastFetchLine_ = ~0UL;
+
+      if (memRef.is_access()) {
+        totalAccess++;
+      }
+    }
+
+    // adds a read of every line a basic block covers. a block that starts
+    // in the line the previous block ended in, on the same core with
+    // nothing in between, skips that line, since fetching it again is a
+    // hit that leaves the cache unchanged
+    void append_basic_block(unsigned long id, int core) {
+      std::unordered_map<unsigned long, BasicBlock>::iterator found =
+        basicBlocks_.find(id);
+      if (found == basicBlocks_.end()) {
+        unknownBlocks_++;
+        return;
+      }
+      BasicBlock &block = found->second;
+      if (block.length == 0) {
+        return;
+      }
+      unsigned long end = block.start + block.length;
+      unsigned long first = block.start & ~offsetMask_;
+      unsigned long last = (end - 1) & ~offsetMask_;
+      unsigned long skipped = core == lastFetchCore_ ? lastFetchLine_ : ~0UL;
+      for (unsigned long line = first; ; line += lineSize_) {
+        if (line != skipped) {
+          unsigned long address = std::max(line, block.start);
+          append_mem_ref(ReadOrWrite::READ,
+              std::min(end, line + lineSize_) - address, address, core);
+        }
+        if (line == last) {
+          break;
+        }
+      }
+      lastFetchLine_ = last;
+      lastFetchCore_ = core;
+    }
+
+    // sets hit or miss for every decoded memRef using the selected engine
+    void simulate_mem_refs() {
+      // BIP and DIP carry state from one set to the next, so their results
+      // depend on the exact order of every miss
+      bool orderedInsertion = insertionPolicy_ == InsertionPolicy::BIP
+        || insertionPolicy_ == InsertionPolicy::DIP;
+
+      if (!lowerLevels_.empty()) {
+        simulate_hierarchy();
+      } else if (plugin_ != NULL) {
+        simulate_plugin();
+      } else if (orderedInsertion || conflictGraph_ != NULL) {
+        // so does the conflict graph's sketch
+        simulate_serial();
+      } else if (engine_ == SimEngine::PARALLEL && threads_ > 1
+          && memRef_.size() >= (size_t)threads_) {
+        simulate_parallel();
+      } else if (engine_ == SimEngine::FAST_FORWARD) {
+        simulate_fast_forward();
+      } else {
+        simulate_serial();
+      }
+    }
+
+    // runs the references one at a time in trace order
+    void simulate_serial() {
+      for (std::vector<MemRef>::iterator it = memRef_.begin();
+          it != memRef_.end(); ++it) {
+        simulate_mem_ref(*it);
+      }
+    }
+
+    // runs the references in trace order with the plugin's replacement
+    // policy in place of LRU
+    void simulate_plugin() {
+      for (std::vector<MemRef>::iterator it = memRef_.begin();
+          it != memRef_.end(); ++it) {
+        unsigned long index = it->getIndex();
+        unsigned long tag = it->getTag();
+        CacheSet &cacheSet = cacheSet_[index];
+        cacheSet.sync_epoch(epoch_);
+
+        if (it->getRW() == ReadOrWrite::INVALIDATE) {
+          int way = cacheSet.find_way(tag);
+          if (way >= 0) {
+            cacheSet.clear_way(way);
+            plugin_->invalidate(index, way, tag);
+          }
+          continue;
+        }
+        if (!it->is_access()) {
+          if (is_flush(*it)) {
+            flush_cache();
+            plugin_->reset();
+          }
+          continue;
+        }
+
+        int way = cacheSet.find_way(tag);
+        if (way >= 0) {
+          totalHits++;
+          it->setHM(true);
+          plugin_->hit(index, way, tag);
+          continue;
+        }
+        totalMiss++;
+        it->setHM(false);
+        way = cacheSet.free_way();
+        if (way < 0) {
+          way = plugin_->victim(index, cacheSet.get_lines());
+          record_conflict(index, tag, cacheSet.get_lines()[way].getTag());
+        }
+        cacheSet.fill_way(way, tag);
+        plugin_->fill(index, way, tag);
+      }
+      plugin_->deliver();
+    }
+
+    // applies one decoded record to the cache
+    void simulate_mem_ref(MemRef &memRef) {
+      switch (memRef.getRW()) {
+        case ReadOrWrite::READ:
+        case ReadOrWrite::WRITE:
+          // set hit or miss for memRef based on return from determine function
+          memRef.setHM(determine_hit_or_miss(memRef.getIndex(),
+                memRef.getTag()));
+          break;
+        case ReadOrWrite::INVALIDATE:
+          invalidate_address(memRef.getIndex(), memRef.getTag());
+          break;
+        case ReadOrWrite::FLUSH:
+        case ReadOrWrite::SWITCH:
+          if (is_flush(memRef)) {
+            flush_cache();
+          }
+          break;
+        default:
+          break;
+      }
+    }
+
+    // lines carry no address space id, so an address space switch flushes
+    // the cache unless addresses are translated to physical ones
+    bool is_flush(MemRef &memRef) {
+      return memRef.getRW() == ReadOrWrite::FLUSH
+        || (memRef.getRW() == ReadOrWrite::SWITCH && !is_translated());
+    }
+
+    // drops one line, returning true if it held modified data
+    bool invalidate_address(unsigned long index, unsigned long tag) {
+      bool wasDirty = false;
+      cacheSet_[index].sync_epoch(epoch_);
+      cacheSet_[index].invalidate_line(tag, wasDirty);
+      return wasDirty;
+    }
+
+    // invalidates every line in O(1). sets notice the new epoch and empty
+    // themselves the next time they are used
+    void flush_cache() {
+      epoch_++;
+    }
+
+    // empties the cache and clears the counters, keeping the allocated
+    // sets, so the same table can run another trace or configuration
+    void reset_cache() {
+      flush_cache();
+      memRef_.clear();
+      totalHits = 0;
+      totalMiss = 0;
+      totalAccess = 0;
+      writebacks_ = 0;
+      backInvalidations_ = 0;
+      memoryReads_ = 0;
+      memoryWrites_ = 0;
+      psel_ = pselMax_ / 2 + 1;
+    }
+
+    // splits the trace into one time chunk per thread. every chunk after
+    // the first is simulated speculatively from a cold cache. afterwards
+    // each chunk's prefix is re-simulated from its predecessor's true final
+    // state, one set at a time, until that set's LRU order matches the
+    // speculative run. from then on the speculative results are exact.
+    void simulate_parallel() {
+      size_t chunkSize = (memRef_.size() + threads_ - 1) / threads_;
+      std::vector<size_t> chunkStart;
+      for (size_t start = 0; start < memRef_.size(); start += chunkSize) {
+        chunkStart.push_back(start);
+      }
+      chunkStart.push_back(memRef_.size());
+      int numberOfChunks = chunkStart.size() - 1;
+
+      // blank sets stand in for the unknown incoming state
+      std::vector<CacheSet> blankSets;
+      for (int i = 0; i < numberOfSets_; ++i) {
+        blankSets.push_back(CacheSet(setSize_));
+        blankSets.back().setIndex(i);
+        blankSets.back().set_epoch(epoch_);
+      }
+
+      // speculative pass, one thread per chunk. every chunk starts at the
+      // current epoch and counts its own flushes
+      std::vector< std::vector<CacheSet> > finalSets(numberOfChunks);
+      std::vector<unsigned long> finalEpoch(numberOfChunks, epoch_);
+      std::vector<std::thread> workers;
+      for (int k = 0; k < numberOfChunks; ++k) {
+        finalSets[k] = (k == 0) ? cacheSet_ : blankSets;
+        workers.push_back(std::thread(&CacheTable::simulate_chunk, this,
+              std::ref(finalSets[k]), std::ref(finalEpoch[k]),
+              chunkStart[k], chunkStart[k + 1]));
+      }
+      for (std::vector<std::thread>::iterator it = workers.begin();
+          it != workers.end(); ++it) {
+        it->join();
+      }
+
+      // fix-up pass, in chunk order since each needs its predecessor
+      for (int k = 1; k < numberOfChunks; ++k) {
+        fix_up_chunk(finalSets[k - 1], finalEpoch[k - 1], blankSets,
+            finalSets[k], finalEpoch[k], chunkStart[k], chunkStart[k + 1]);
+      }
+      cacheSet_ = finalSets[numberOfChunks - 1];
+      epoch_ = finalEpoch[numberOfChunks - 1];
+
+      // the per-chunk results are final now, so count them
+      count_results();
+    }
+
+    // totals hits and misses from results set outside determine_hit_or_miss
+    void count_results() {
+      totalHits = 0;
+      totalMiss = 0;
+      for (std::vector<MemRef>::iterator it = memRef_.begin();
+          it != memRef_.end(); ++it) {
+        if (!it->is_access()) {
+          continue;
+        }
+        if (it->getHM()) {
+          totalHits++;
+        } else {
+          totalMiss++;
+        }
+      }
+    }
+
+    // simulates memRef_[begin, end) against the given sets. epoch is the
+    // sets' epoch, and is advanced by every flush in the chunk
+    void simulate_chunk(std::vector<CacheSet> &sets, unsigned long &epoch,
+        size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        apply_to_sets(sets, epoch, memRef_[i]);
+      }
+    }
+
+    // applies one decoded record to a private copy of the sets, returning
+    // hit or miss for accesses
+    bool apply_to_sets(std::vector<CacheSet> &sets, unsigned long &epoch,
+        MemRef &memRef) {
+      if (is_flush(memRef)) {
+        epoch++;
+        return false;
+      } else if (memRef.getRW() == ReadOrWrite::SWITCH) {
+        return false;
+      }
+      CacheSet &cacheSet = sets[memRef.getIndex()];
+      if (memRef.getRW() == ReadOrWrite::INVALIDATE) {
+        bool wasDirty = false;
+        cacheSet.sync_epoch(epoch);
+        cacheSet.invalidate_line(memRef.getTag(), wasDirty);
+        return false;
+      }
+      bool hit = access_set(cacheSet, memRef.getTag(), epoch);
+      memRef.setHM(hit);
+      return hit;
+    }
+
+    // re-simulates the start of a speculative chunk from the true incoming
+    // state. finalSets holds the speculative end state on entry and the
+    // true end state on return, both at epoch finalEpoch.
+    void fix_up_chunk(std::vector<CacheSet> &incoming,
+        unsigned long incomingEpoch, std::vector<CacheSet> &blankSets,
+        std::vector<CacheSet> &finalSets, unsigned long finalEpoch,
+        size_t begin, size_t end) {
+      std::vector<CacheSet> trueSets = incoming;
+      std::vector<CacheSet> specSets = blankSets;
+      unsigned long trueEpoch = incomingEpoch;
+      unsigned long specEpoch = epoch_;
+
+      // a set is settled once it converges or has no references left.
+      // sets that run out keep the true state, which is only complete
+      // once the flushes after their last reference are applied
+      std::vector<size_t> remaining(numberOfSets_, 0);
+      for (size_t i = begin; i < end; ++i) {
+        if (memRef_[i].getRW() != ReadOrWrite::FLUSH
+            && memRef_[i].getRW() != ReadOrWrite::SWITCH) {
+          remaining[memRef_[i].getIndex()]++;
+        }
+      }
+      std::vector<bool> settled(numberOfSets_, false);
+      std::vector<int> exhausted;
+      int unsettled = numberOfSets_;
+      for (int s = 0; s < numberOfSets_; ++s) {
+        if (remaining[s] == 0) {
+          // untouched by this chunk, so it passes through unchanged
+          exhausted.push_back(s);
+          settled[s] = true;
+          unsettled--;
+        }
+      }
+
+      for (size_t i = begin; i < end && unsettled > 0; ++i) {
+        if (is_flush(memRef_[i])) {
+          trueEpoch++;
+          specEpoch++;
+          continue;
+        } else if (memRef_[i].getRW() == ReadOrWrite::SWITCH) {
+          continue;
+        }
+        int s = memRef_[i].getIndex();
+        if (settled[s]) {
+          continue;
+        }
+        apply_to_sets(trueSets, trueEpoch, memRef_[i]);
+        MemRef replay = memRef_[i];
+        apply_to_sets(specSets, specEpoch, replay);
+        remaining[s]--;
+
+        if (trueSets[s].same_state(specSets[s])) {
+          // the speculative results and end state are exact from here on
+          settled[s] = true;
+          unsettled--;
+        } else if (remaining[s] == 0) {
+          exhausted.push_back(s);
+          settled[s] = true;
+          unsettled--;
+        }
+      }
+
+      unsigned long trueFinalEpoch = incomingEpoch + (finalEpoch - epoch_);
+      for (std::vector<int>::iterator it = exhausted.begin();
+          it != exhausted.end(); ++it) {
+        finalSets[*it] = trueSets[*it];
+        finalSets[*it].sync_epoch(trueFinalEpoch);
+        finalSets[*it].set_epoch(finalEpoch);
+      }
+    }
+
+    // runs the references in trace order, but looks for repeating loop
+    // bodies and skips over their iterations once the cache state stops
+    // changing from one iteration to the next
+    void simulate_fast_forward() {
+      size_t i = 0;
+      size_t nextProbe = 0;
+      while (i < memRef_.size()) {
+        if (i >= nextProbe) {
+          size_t period = 0;
+          long stride = 0;
+          if (find_loop_period(i, period, stride)) {
+            i = fast_forward_loop(i, period, stride);
+            nextProbe = i + loopProbeInterval_;
+            continue;
+          }
+          // probing is not free, so don't try again for a while
+          nextProbe = i + loopProbeInterval_;
+        }
+        simulate_mem_ref(memRef_[i]);
+        ++i;
+      }
+    }
+
+    // true if memRef_[j] repeats memRef_[j - period] moved by stride
+    bool repeats_with_stride(size_t j, size_t period, long stride) {
+      MemRef &current = memRef_[j];
+      MemRef &previous = memRef_[j - period];
+      return current.getRW() == previous.getRW()
+        && current.getSize() == previous.getSize()
+        && current.getAddress() - previous.getAddress() == (unsigned long)stride;
+    }
+
+    // looks for the shortest period, starting at memRef_[start], where the
+    // next loopMinIterations_ iterations repeat the first one moved by a
+    // constant stride. only strides that keep every reference in the same
+    // set are accepted, so an iteration only changes the tags.
+    bool find_loop_period(size_t start, size_t &period, long &stride) {
+      unsigned long setSpan = (unsigned long)numberOfSets_ * lineSize_;
+      for (size_t p = 1; p <= loopMaxPeriod_; ++p) {
+        if (start + p * (loopMinIterations_ + 1) > memRef_.size()) {
+          return false;
+        }
+        long candidate = memRef_[start + p].getAddress()
+          - memRef_[start].getAddress();
+        if ((unsigned long)candidate % setSpan != 0
+            && (unsigned long)(-candidate) % setSpan != 0) {
+          continue;
+        }
+
+        size_t j = start + p;
+        size_t end = start + p * (loopMinIterations_ + 1);
+        while (j < end && repeats_with_stride(j, p, candidate)) {
+          ++j;
+        }
+        // flushes and invalidates in the body aren't extrapolated
+        bool onlyAccesses = true;
+        for (size_t k = start; k < start + p && onlyAccesses; ++k) {
+          onlyAccesses = memRef_[k].is_access();
+        }
+        if (j == end && onlyAccesses) {
+          period = p;
+          stride = candidate;
+          return true;
+        }
+      }
+      return false;
+    }
+
+    // simulates iterations of the loop at memRef_[start] until the touched
+    // sets reach a fixpoint (the state after an iteration is the state
+    // before it with every tag moved by the stride), giving up after
+    // loopMaxWarmup_ iterations without one. the outcome of that
+    // iteration then repeats for as long as the trace keeps following the
+    // loop, so those iterations are filled in without simulating them.
+    // returns the first reference that still needs to be simulated.
+    size_t fast_forward_loop(size_t start, size_t period, long stride) {
+      long tagDelta = stride / ((long)numberOfSets_ * lineSize_);
+
+      // the sets the loop body uses
+      std::vector<int> touched;
+      for (size_t j = start; j < start + period; ++j) {
+        touched.push_back(memRef_[j].getIndex());
+      }
+      std::sort(touched.begin(), touched.end());
+      touched.erase(std::unique(touched.begin(), touched.end()),
+          touched.end());
+      for (std::vector<int>::iterator it = touched.begin();
+          it != touched.end(); ++it) {
+        cacheSet_[*it].sync_epoch(epoch_);
+      }
+
+      size_t iteration = start;
+      size_t warmupEnd = start + period * loopMaxWarmup_;
+      while (iteration + period <= memRef_.size() && iteration < warmupEnd) {
+        // the exactness check: stop once the trace leaves the loop
+        if (iteration > start && !iteration_repeats(iteration, period, stride)) {
+          return iteration;
+        }
+
+        std::vector< std::vector<unsigned long> > before;
+        for (std::vector<int>::iterator it = touched.begin();
+            it != touched.end(); ++it) {
+          before.push_back(cacheSet_[*it].recency_order());
+        }
+
+        for (size_t j = iteration; j < iteration + period; ++j) {
+          memRef_[j].setHM(determine_hit_or_miss(memRef_[j].getIndex(),
+                memRef_[j].getTag()));
+        }
+
+        if (reached_fixpoint(touched, before, tagDelta)) {
+          return extrapolate_loop(iteration, period, stride, tagDelta,
+              touched);
+        }
+        iteration += period;
+      }
+      return iteration;
+    }
+
+    // true if the iteration at memRef_[iteration] repeats the one before it
+    bool iteration_repeats(size_t iteration, size_t period, long stride) {
+      for (size_t j = iteration; j < iteration + period; ++j) {
+        if (!repeats_with_stride(j, period, stride)) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    bool reached_fixpoint(std::vector<int> &touched,
+        std::vector< std::vector<unsigned long> > &before, long tagDelta) {
+      for (size_t k = 0; k < touched.size(); ++k) {
+        std::vector<unsigned long> after = cacheSet_[touched[k]].recency_order();
+        if (after.size() != before[k].size()) {
+          return false;
+        }
+        for (size_t w = 0; w < after.size(); ++w) {
+          if (after[w] != before[k][w] + tagDelta) {
+            return false;
+          }
+        }
+      }
+      return true;
+    }
+
+    // copies the outcome of the fixpoint iteration at memRef_[fixpoint] to
+    // every following iteration that still follows the loop, then moves
+    // the touched sets to the state they would have after the last one
+    size_t extrapolate_loop(size_t fixpoint, size_t period, long stride,
+        long tagDelta, std::vector<int> &touched) {
+      int hitsPerIteration = 0;
+      for (size_t j = fixpoint; j < fixpoint + period; ++j) {
+        if (memRef_[j].getHM()) {
+          hitsPerIteration++;
+        }
+      }
+
+      size_t iteration = fixpoint + period;
+      long skipped = 0;
+      while (iteration + period <= memRef_.size()
+          && iteration_repeats(iteration, period, stride)) {
+        for (size_t j = iteration; j < iteration + period; ++j) {
+          memRef_[j].setHM(memRef_[j - period].getHM());
+        }
+        iteration += period;
+        skipped++;
+      }
+
+      totalHits += skipped * hitsPerIteration;
+      totalMiss += skipped * (period - hitsPerIteration);
+      for (std::vector<int>::iterator it = touched.begin();
+          it != touched.end(); ++it) {
+        cacheSet_[*it].shift_tags(skipped * tagDelta);
+      }
+      return iteration;
+    }
+
+    // runs the trace through this table as the first level, with every
+    // lower level on its own thread. a level only sees the misses and
+    // writebacks of the level above it, so the hierarchy runs at the speed
+    // of its slowest level instead of the sum of all of them. in an
+    // inclusive hierarchy a level waits for each of its misses to complete
+    // below it, so back-invalidations are applied in trace order.
+    void simulate_hierarchy() {
+      std::vector<LevelLink> links(lowerLevels_.size());
+      std::vector<std::thread> workers;
+      for (size_t k = 0; k < lowerLevels_.size(); ++k) {
+        LevelLink *below = (k + 1 < links.size()) ? &links[k + 1] : NULL;
+        workers.push_back(std::thread(&CacheTable::run_lower_level,
+              lowerLevels_[k], &links[k], below));
+      }
+
+      unsigned long sent = 0;
+      for (std::vector<MemRef>::iterator it = memRef_.begin();
+          it != memRef_.end(); ++it) {
+        if (it->getRW() == ReadOrWrite::INVALIDATE) {
+          apply_level_flush(LevelOp::FLUSH_LINE, it->getAddress(), &links[0],
+              NULL, sent);
+          continue;
+        } else if (is_flush(*it)) {
+          apply_level_flush(LevelOp::FLUSH_ALL, 0, &links[0], NULL, sent);
+          continue;
+        } else if (!it->is_access()) {
+          continue;
+        }
+
+        CacheLine victim;
+        bool evicted = false;
+        bool hit = access_line(it->getIndex(), it->getTag(),
+            it->getRW() == ReadOrWrite::WRITE, victim, evicted);
+        it->setHM(hit);
+
+        if (!hit) {
+          LevelMessage fill = {LevelOp::READ, it->getAddress() & ~offsetMask_};
+          links[0].requests.push(fill);
+          sent++;
+          if (evicted && victim.is_dirty()) {
+            LevelMessage writeback = {LevelOp::WRITE,
+              line_address(it->getIndex(), victim.getTag())};
+            links[0].requests.push(writeback);
+            sent++;
+          }
+          if (inclusive_) {
+            wait_for_lower_level(links[0], sent, NULL);
+          }
+        }
+      }
+
+      LevelMessage end = {LevelOp::END, 0};
+      links[0].requests.push(end);
+      for (std::vector<std::thread>::iterator it = workers.begin();
+          it != workers.end(); ++it) {
+        it->join();
+      }
+    }
+
+    // the loop for a level below the first. takes requests from the level
+    // above until it sees END, and passes its own misses and writebacks on
+    // to the level below, or to memory if it is the last level
+    void run_lower_level(LevelLink *above, LevelLink *below) {
+      unsigned long sent = 0;
+      LevelMessage request;
+      while (true) {
+        if (!above->requests.pop(request)) {
+          std::this_thread::yield();
+          continue;
+        }
+        if (request.op == LevelOp::END) {
+          if (below != NULL) {
+            below->requests.push(request);
+          }
+          break;
+        }
+        if (request.op == LevelOp::FLUSH_LINE
+            || request.op == LevelOp::FLUSH_ALL) {
+          apply_level_flush(request.op, request.address, below, above, sent);
+          above->completed.store(above->completed.load(std::memory_order_relaxed)
+              + 1, std::memory_order_release);
+          continue;
+        }
+
+        totalAccess++;
+        unsigned long index = (request.address & indexMask_) >> offsetSize_;
+        unsigned long tag = request.address >> (indexSize_ + offsetSize_);
+        CacheLine victim;
+        bool evicted = false;
+        bool hit = access_line(index, tag, request.op == LevelOp::WRITE,
+            victim, evicted);
+
+        if (!hit) {
+          if (below != NULL) {
+            LevelMessage fill = {LevelOp::READ, request.address & ~offsetMask_};
+            below->requests.push(fill);
+            sent++;
+          } else {
+            memoryReads_++;
+            if (recordTraffic_) {
+              memoryTraffic_.push_back(request.address & ~offsetMask_);
+            }
+          }
+        }
+        if (evicted) {
+          unsigned long victimAddress = line_address(index, victim.getTag());
+          if (victim.is_dirty()) {
+            if (below != NULL) {
+              LevelMessage writeback = {LevelOp::WRITE, victimAddress};
+              below->requests.push(writeback);
+              sent++;
+            } else {
+              memoryWrites_++;
+            }
+          }
+          if (inclusive_) {
+            // the levels above may no longer hold the line
+            LevelMessage invalidate = {LevelOp::INVALIDATE, victimAddress};
+            above->invalidations.push(invalidate);
+          }
+        }
+
+        if (inclusive_ && below != NULL) {
+          wait_for_lower_level(*below, sent, above);
+        }
+        above->completed.store(above->completed.load(std::memory_order_relaxed)
+            + 1, std::memory_order_release);
+      }
+    }
+
+    // applies an invalidate or flush record to this level and passes it on
+    // to the level below, adding the messages sent down to sent. a line
+    // invalidate writes modified data back to memory. a full flush first
+    // writes every modified line back to the level below, which is flushed
+    // next, so the data reaches memory the way -mrc counts it
+    void apply_level_flush(LevelOp op, unsigned long address,
+        LevelLink *below, LevelLink *above, unsigned long &sent) {
+      if (op == LevelOp::FLUSH_LINE) {
+        unsigned long index = (address & indexMask_) >> offsetSize_;
+        unsigned long tag = address >> (indexSize_ + offsetSize_);
+        if (invalidate_address(index, tag)) {
+          memoryWrites_++;
+        }
+      } else {
+        unsigned long written = write_back_dirty_lines(below);
+        sent += written;
+        if (inclusive_ && below != NULL && written > 0) {
+          // the writebacks may evict lines below, whose back-invalidations
+          // must not reach lines filled after the flush
+          wait_for_lower_level(*below, sent, above);
+        }
+        flush_cache();
+      }
+      if (below == NULL) {
+        return;
+      }
+      LevelMessage flush = {op, address};
+      below->requests.push(flush);
+      sent++;
+    }
+
+    // writes every modified line back to the level below, or to memory if
+    // this is the last level. returns the number of messages sent down
+    unsigned long write_back_dirty_lines(LevelLink *below) {
+      unsigned long written = 0;
+      for (size_t index = 0; index < cacheSet_.size(); ++index) {
+        CacheSet &cacheSet = cacheSet_[index];
+        cacheSet.sync_epoch(epoch_);
+        std::vector<CacheLine> &lines = cacheSet.get_lines();
+        for (std::vector<CacheLine>::iterator it = lines.begin();
+            it != lines.end(); ++it) {
+          if (!it->is_valid() || !it->is_dirty()) {
+            continue;
+          }
+          writebacks_++;
+          if (below != NULL) {
+            LevelMessage writeback = {LevelOp::WRITE,
+              line_address(index, it->getTag())};
+            below->requests.push(writeback);
+            written++;
+          } else {
+            memoryWrites_++;
+          }
+        }
+      }
+      return written;
+    }
+
+    // waits until the level below has finished every request sent to it,
+    // then applies the back-invalidations it produced, passing the ones
+    // that hit on to the level above
+    void wait_for_lower_level(LevelLink &below, unsigned long sent,
+        LevelLink *above) {
+      while (below.completed.load(std::memory_order_acquire) < sent) {
+        std::this_thread::yield();
+      }
+      LevelMessage invalidate;
+      while (below.invalidations.pop(invalidate)) {
+        unsigned long index = (invalidate.address & indexMask_) >> offsetSize_;
+        unsigned long tag = invalidate.address >> (indexSize_ + offsetSize_);
+        bool wasDirty = false;
+        cacheSet_[index].sync_epoch(epoch_);
+        if (cacheSet_[index].invalidate_line(tag, wasDirty)) {
+          backInvalidations_++;
+          if (wasDirty) {
+            // the level below already dropped the line, so it goes to memory
+            memoryWrites_++;
+          }
+          if (above != NULL) {
+            above->invalidations.push(invalidate);
+          }
+        }
+      }
+    }
+
+    // looks up a line and fills it on a miss, keeping track of dirty data.
+    // a line pushed out by the fill is copied to victim
+    bool access_line(unsigned long index, unsigned long tag, bool write,
+        CacheLine &victim, bool &evicted) {
+      CacheSet &cacheSet = cacheSet_[index];
+      cacheSet.sync_epoch(epoch_);
+      bool hit = cacheSet.check_cache_lines(tag);
+      if (!hit) {
+        evicted = cacheSet.update_cache_lines(tag, &victim,
+            insert_at_LRU(index));
+        if (evicted) {
+          record_conflict(index, tag, victim.getTag());
+        }
+      }
+      if (write) {
+        cacheSet.mark_dirty(tag);
+      }
+      if (hit) {
+        totalHits++;
+      } else {
+        totalMiss++;
+      }
+      if (evicted && victim.is_dirty()) {
+        writebacks_++;
+      }
+      return hit;
+    }
+
+    void record_conflict(unsigned long index, unsigned long tag,
+        unsigned long victimTag) {
+      if (conflictGraph_ != NULL) {
+        conflictGraph_->record(index, line_address(index, tag),
+            line_address(index, victimTag));
+      }
+    }
+
+    // split an address with this table's geometry
+    unsigned long index_of(unsigned long address) {
+      return (address & indexMask_) >> offsetSize_;
+    }
+
+    unsigned long tag_of(unsigned long address) {
+      return address >> (indexSize_ + offsetSize_);
+    }
+
+    // true if the line is cached, without touching the LRU order
+    bool holds_line(unsigned long index, unsigned long tag) {
+      cacheSet_[index].sync_epoch(epoch_);
+      return cacheSet_[index].find_line(tag) != NULL;
+    }
+
+    // rebuilds the address of the first byte of a line from its position
+    unsigned long line_address(unsigned long index, unsigned long tag) {
+      return (tag << (indexSize_ + offsetSize_)) | (index << offsetSize_);
+    }
+
+    void print_hierarchy_summary() {
+      std::cout << "\n";
+      std::cout << "    Hierarchy Summary\n";
+      std::cout << "**************************\n";
+      print_level_summary(1);
+      for (size_t k = 0; k < lowerLevels_.size(); ++k) {
+        lowerLevels_[k]->print_level_summary(k + 2);
+      }
+      // dirty lines dropped by back-invalidations go straight to memory
+      unsigned long memoryWrites = memoryWrites_;
+      for (std::vector<CacheTable*>::iterator it = lowerLevels_.begin();
+          it != lowerLevels_.end(); ++it) {
+        memoryWrites += (*it)->memoryWrites_;
+      }
+      std::cout << "Memory Reads:\t"  << lowerLevels_.back()->memoryReads_ << "\n";
+      std::cout << "Memory Writes:\t" << memoryWrites << "\n";
+    }
+
+    void print_level_summary(int level) {
+      std::cout << "L" << level << " Accesses:\t" << totalAccess << "\n";
+      std::cout << "L" << level << " Hits:\t"     << totalHits << "\n";
+      std::cout << "L" << level << " Misses:\t"   << totalMiss << "\n";
+      std::cout << "L" << level << " Writebacks:\t" << writebacks_ << "\n";
+      if (inclusive_) {
+        std::cout << "L" << level << " Back-Invalidations:\t"
+          << backInvalidations_ << "\n";
+      }
+    }
+
+    // looks up a tag in one set and fills it on a miss
+    bool access_set(CacheSet &cacheSet, unsigned long tag,
+        unsigned long epoch) {
+      cacheSet.sync_epoch(epoch);
+      if (cacheSet.check_cache_lines(tag)) {
+        return true;
+      }
+      cacheSet.update_cache_lines(tag, NULL,
+          insertionPolicy_ == InsertionPolicy::LIP);
+      return false;
+    }
+
+    // decides where the line filled by a miss in set index goes. for DIP
+    // a miss in a leader set also moves PSEL towards the other policy
+    bool insert_at_LRU(unsigned long index) {
+      switch (insertionPolicy_) {
+        case InsertionPolicy::LIP:
+          return true;
+        case InsertionPolicy::BIP:
+          return bimodal_insert_at_LRU();
+        case InsertionPolicy::DIP:
+          if (index % duelSpacing_ == 0) {
+            // LRU leader
+            if (psel_ < pselMax_) {
+              psel_++;
+            }
+            return false;
+          } else if (index % duelSpacing_ == 1) {
+            // BIP leader
+            if (psel_ > 0) {
+              psel_--;
+            }
+            return bimodal_insert_at_LRU();
+          }
+          // followers use whichever leader group is missing less
+          return psel_ > pselMax_ / 2 ? bimodal_insert_at_LRU() : false;
+        default:
+          return false;
+      }
+    }
+
+    // inserts at the MRU end with probability 1 / bipThrottle_
+    bool bimodal_insert_at_LRU() {
+      // xorshift32
+      bipState_ ^= bipState_ << 13;
+      bipState_ ^= bipState_ >> 17;
+      bipState_ ^= bipState_ << 5;
+      return bipState_ % bipThrottle_ != 0;
+    }
+
+
+    // determine whether the mem reference was a hit or miss
+    bool determine_hit_or_miss(unsigned long index, unsigned long tag) {
+      // iterate through all cacheSets and
+      // compare memRef index to cache lines index
+
+      for (std::vector<CacheSet>::iterator it = cacheSet_.begin(); 
+          it != cacheSet_.end(); ++it) {
 
         // does memRef index match cacheSets index?
         if (index == it->getIndex()) {
           // if index match
           // compare memRef tag to cache lines tag for that cache set
+          it->sync_epoch(epoch_);
+
+          if (it->check_cache_lines(tag)) {
+            // if tag matches cacheline then report hit
+            totalHits++;
+            return true;
+          } else {
+            // if no match
+            CacheLine victim;
+            if (it->update_cache_lines(tag, &victim, insert_at_LRU(index))) {
+              record_conflict(index, tag, victim.getTag());
+            }
+            break;
+          }
+        } 
+        }
+          // if no index match
+          // then MISS
+          totalMiss++;
+          return false;
+    }
+
+    // generates the cache sets according to info from config file
+    void create_cache_sets(int numberOfSets_) {
+      for (int i = 0; i < numberOfSets_; ++i) {
+        CacheSet *cacheSet = new CacheSet(setSize_);
+        cacheSet_.push_back(*cacheSet); 
+      }
+    }
+
+    // iterate through all of the cacheSets and set their index numbers
+    void set_index_for_cache_sets() {
+      int indexSetter = 0;
+      for (std::vector<CacheSet>::iterator it = cacheSet_.begin(); 
+          it != cacheSet_.end(); ++it) {
+        it->setIndex(indexSetter++);
+      }
+    }
+
+    // setters
+    int set_total_cache_size(int totalCacheSize) {
+      totalCacheSize_ = totalCacheSize;
+      return 0;
+    }
+
+    int set_line_size(int lineSize) {
+      lineSize_ = lineSize;
+      return 0;
+    }
+
+    int set_set_size(int setSize) {
+      setSize_ = setSize;
+      return 0;
+    }
+
+    void set_engine(SimEngine engine) {
+      engine_ = engine;
+    }
+
+    void set_threads(int threads) {
+      threads_ = threads;
+    }
+
+    // leaves the engine to select_engine()
+    void set_auto_engine() {
+      autoEngine_ = true;
+    }
+
+    bool is_auto_engine() {
+      return autoEngine_;
+    }
+
+    // picks the fastest engine for this host and configuration. each
+    // candidate runs a prefix of the decoded trace on a scratch table, and
+    // the winner is kept in an engine cache file, so later runs with the
+    // same host and configuration skip the timing
+    void select_engine() {
+      // hierarchies, plugins, BIP, DIP and the conflict graph always run
+      // on their own engines
+      if (!lowerLevels_.empty() || plugin_ != NULL || conflictGraph_ != NULL
+          || insertionPolicy_ == InsertionPolicy::BIP
+          || insertionPolicy_ == InsertionPolicy::DIP) {
+        return;
+      }
+      std::string cachePath = engine_cache_path();
+      std::string key = engine_cache_key();
+
+      // each entry is the key, the engine and its threads. the last valid
+      // entry for the key wins, and a damaged one is ignored
+      std::ifstream is(cachePath.c_str());
+      std::string entryKey;
+      int entryEngine, entryThreads;
+      bool cached = false;
+      while (is >> entryKey >> entryEngine >> entryThreads) {
+        if (entryKey == key && entryEngine >= (int)SimEngine::SERIAL
+            && entryEngine <= (int)SimEngine::FAST_FORWARD
+            && entryThreads >= 1) {
+          engine_ = (SimEngine)entryEngine;
+          threads_ = entryThreads;
+          cached = true;
+        }
+      }
+      is.close();
+      if (cached) {
+        engineChoice_ = std::string(engine_name(engine_)) + " (cached)";
+        return;
+      }
+
+      int hardwareThreads = std::thread::hardware_concurrency();
+      int parallelThreads = threads_ > 1 ? threads_ : hardwareThreads;
+      SimEngine candidates[] = {SimEngine::SERIAL, SimEngine::FAST_FORWARD,
+        SimEngine::PARALLEL};
+      const size_t prefix = std::min(memRef_.size(), (size_t)1 << 18);
+
+      CacheTable scratch;
+      scratch.configure(setSize_, lineSize_, totalCacheSize_);
+      scratch.copy_options(*this);
+      double best = INFINITY;
+      for (int c = 0; c < 3; ++c) {
+        if (candidates[c] == SimEngine::PARALLEL && parallelThreads < 2) {
+          continue;
+        }
+        scratch.set_engine(candidates[c]);
+        scratch.set_threads(candidates[c] == SimEngine::PARALLEL
+            ? parallelThreads : 1);
+        // the faster of two runs, so the first touch of the scratch sets
+        // is not charged to one engine
+        for (int run = 0; run < 2; ++run) {
+          scratch.reset_cache();
+          scratch.memRef_.assign(memRef_.begin(), memRef_.begin() + prefix);
+          std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+          scratch.simulate_mem_refs();
+          std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+          if (elapsed.count() < best) {
+            best = elapsed.count();
+            engine_ = candidates[c];
+            threads_ = scratch.threads_;
+          }
+        }
+      }
+      engineChoice_ = std::string(engine_name(engine_)) + " (calibrated)";
+
+      // the cache is only a shortcut, so failing to write it is not an
+      // error
+      size_t slash = cachePath.rfind('/');
+      if (slash != std::string::npos) {
+        mkdir(cachePath.substr(0, slash).c_str(), 0755);
+      }
+      std::ofstream os(cachePath.c_str(), std::ios::app);
+      os << key << " " << (int)engine_ << " " << threads_ << "\n";
+    }
+
+    static const char *engine_name(SimEngine engine) {
+      if (engine == SimEngine::PARALLEL) {
+        return "parallel";
+      } else if (engine == SimEngine::FAST_FORWARD) {
+        return "fast-forward";
+      }
+      return "serial";
+    }
+
+    // $CACHESIM_ENGINE_CACHE, or cacheSim/engines under the user's cache
+    // directory
+    static std::string engine_cache_path() {
+      const char *path = getenv("CACHESIM_ENGINE_CACHE");
+      if (path != NULL) {
+        return path;
+      }
+      const char *cacheHome = getenv("XDG_CACHE_HOME");
+      const char *home = getenv("HOME");
+      std::string directory = cacheHome != NULL ? cacheHome
+        : std::string(home != NULL ? home : ".") + "/.cache";
+      mkdir(directory.c_str(), 0755);
+      return directory + "/cacheSim/engines";
+    }
+
+    // the host and the settings that decide which engine is fastest,
+    // with no spaces
+    std::string engine_cache_key() {
+      char host[256] = {0};
+      gethostname(host, sizeof(host) - 1);
+      std::string cpu = "unknown";
+      std::ifstream cpuinfo("/proc/cpuinfo");
+      std::string line;
+      while (std::getline(cpuinfo, line)) {
+        if (line.compare(0, 10, "model name") == 0) {
+          cpu = line.substr(line.find(':') + 2);
+          break;
+        }
+      }
+      std::string key = std::string(host) + "/" + cpu + "/"
+        + std::to_string(std::thread::hardware_concurrency()) + "/"
+        + std::to_string(totalCacheSize_) + "/" + std::to_string(lineSize_)
+        + "/" + std::to_string(setSize_) + "/"
+        + std::to_string((int)insertionPolicy_) + "/"
+        + std::to_string(threads_) + "/" + std::to_string(loopMaxPeriod_)
+        + "/" + std::to_string(is_translated());
+      std::replace(key.begin(), key.end(), ' ', '_');
+      return key;
+    }
+
+    void set_loop_max_period(size_t loopMaxPeriod) {
+      loopMaxPeriod_ = loopMaxPeriod;
+    }
+
+    // translates every address through pageTable before indexing. the
+    // table takes ownership of it
+    void set_page_table(PageTable *pageTable) {
+      delete pageTable_;
+      pageTable_ = pageTable;
+    }
+
+    bool is_translated() {
+      return pageTable_ != NULL || translated_;
+    }
+
+    // takes a copy of another table's decoded references, split with this
+    // table's geometry, instead of decoding the trace again
+    void adopt_mem_refs(CacheTable &source) {
+      memRef_ = source.get_mem_refs();
+      translated_ = source.is_translated();
+      totalAccess = 0;
+      for (std::vector<MemRef>::iterator it = memRef_.begin();
+          it != memRef_.end(); ++it) {
+        it->calculate_tag(indexSize_, offsetSize_);
+        it->calculate_index(indexMask_, offsetSize_);
+        it->calculate_offset(offsetMask_);
+        it->setHM(false);
+        if (it->is_access()) {
+          totalAccess++;
+        }
+      }
+    }
+
+    // replaces LRU with a policy loaded from a shared library. call after
+    // configure()
+    int load_plugin(const char *path, const char *args) {
+      if (!lowerLevels_.empty()) {
+        std::cerr << "\nError: -plugin cannot be combined with -level\n"
+          << std::endl;
+        return 1;
+      }
+      delete plugin_;
+      plugin_ = new PolicyPlugin;
+      return plugin_->load(path, args, numberOfSets_, setSize_);
+    }
+
+    // follow mode simulates one record at a time on a single level
+    bool can_follow() {
+      return lowerLevels_.empty() && plugin_ == NULL;
+    }
+
+    // the engine and insertion policy settings of another table
+    void copy_options(CacheTable &source) {
+      engine_ = source.engine_;
+      threads_ = source.threads_;
+      loopMaxPeriod_ = source.loopMaxPeriod_;
+      insertionPolicy_ = source.insertionPolicy_;
+    }
+
+    void set_insertion_policy(InsertionPolicy insertionPolicy) {
+      insertionPolicy_ = insertionPolicy;
+    }
+
+    // line addresses of the demand misses that reached memory, in order.
+    // in a hierarchy these are the last level's misses, which it records
+    // once record_memory_traffic() has been called
+    std::vector<unsigned long> get_memory_traffic() {
+      if (!lowerLevels_.empty()) {
+        return lowerLevels_.back()->memoryTraffic_;
+      }
+      std::vector<unsigned long> traffic;
+      for (std::vector<MemRef>::iterator it = memRef_.begin();
+          it != memRef_.end(); ++it) {
+        if (it->is_access() && !it->getHM()) {
+          traffic.push_back(it->getAddress() & ~offsetMask_);
+        }
+      }
+      return traffic;
+    }
+
+    void record_memory_traffic() {
+      if (!lowerLevels_.empty()) {
+        lowerLevels_.back()->recordTraffic_ = true;
+      }
+    }
+
+    // keeps the largest conflict edges between regions of regionSize bytes,
+    // printing the top shown of them. call after configure()
+    void set_conflict_graph(size_t capacity, unsigned long regionSize,
+        size_t shown) {
+      delete conflictGraph_;
+      conflictGraph_ = new ConflictGraph(capacity, regionSize, numberOfSets_);
+      conflictsShown_ = shown;
+    }
+
+    // adds a level below the lowest one so far
+    void add_lower_level(CacheTable *level) {
+      level->set_inclusive(inclusive_);
+      lowerLevels_.push_back(level);
+    }
+
+    void set_inclusive(bool inclusive) {
+      inclusive_ = inclusive;
+      for (std::vector<CacheTable*>::iterator it = lowerLevels_.begin();
+          it != lowerLevels_.end(); ++it) {
+        (*it)->set_inclusive(inclusive);
+      }
+    }
+
+    // getters
+    int get_total_cache_size() {
+      return totalCacheSize_;
+    }
+
+    int get_line_size() {
+      return lineSize_;
+    }
+
+    int get_set_size() {
+      return setSize_;
+    }
+
+    int get_number_of_sets() {
+      return numberOfSets_;
+    }
+
+    int get_total_hits() {
+      return totalHits;
+    }
+
+    int get_total_misses() {
+      return totalMiss;
+    }
+
+    std::vector<MemRef> &get_mem_refs() {
+      return memRef_;
+    }
+
+  private:
+
+    std::vector<CacheSet> 
+      cacheSet_;
+
+    std::vector<MemRef> 
+      memRef_;
+
+    // levels below this one, nearest first
+    std::vector<CacheTable*>
+      lowerLevels_;
+
+    bool
+      inclusive_ = false;
+
+    // virtual to physical translation, NULL for a virtually indexed cache
+    PageTable
+      *pageTable_ = NULL;
+
+    // the references came from a table that translated them
+    bool
+      translated_ = false;
+
+    // address space in effect at the end of the records decoded so far
+    unsigned int
+      decodeAsid_ = 0;
+
+    // op of the last text record decoded
+    ReadOrWrite
+      decodeRW_ = ReadOrWrite::ERROR;
+
+    // start address and length in bytes of a basic block
+    struct BasicBlock {
+      unsigned long
+        start,
+        length;
+    };
+
+    // whether decoded traces are shared through POSIX shared memory
+    bool
+      sharedTrace_ = false;
+
+    // the start of a shared trace segment, followed by its references
+    struct SharedTraceHeader {
+      char
+        key[480];
+
+      uint32_t
+        ready;
+
+      uint64_t
+        count,
+        writesSeen,
+        writesCombined;
+    };
+
+    // file_stamp() of the block table, which shapes the decoded trace
+    std::string
+      blockTableStamp_;
+
+    // a line waiting in a write-combining buffer, and the bytes written
+    // to it
+    struct CombinedWrite {
+      unsigned long
+        line;
+
+      int
+        size;
+    };
+
+    // each core's write-combining buffer, oldest entry first
+    std::vector< std::vector<CombinedWrite> >
+      writeBuffers_;
+
+    size_t
+      writeCombining_ = 0;
+
+    // writes that reached the buffers, and those merged into an entry
+    unsigned long
+      writesSeen_ = 0,
+      writesCombined_ = 0;
+
+    // cores in a trace are numbered from 0 up to this limit, which keeps
+    // the per-core write-combining buffers bounded
+    static const int
+      MAX_CORES = 1 << 16;
+
+    // the block table, by block id
+    std::unordered_map<unsigned long, BasicBlock>
+      basicBlocks_;
+
+    // the line the last basic block ended in, while it is the last
+    // record, or ~0 otherwise, and the core that fetched it
+    unsigned long
+      lastFetchLine_ = ~0UL,
+      unknownBlocks_ = 0;
+
+    int
+      lastFetchCore_ = 0;
+
+    // records decoded and already dropped from memRef_ by follow mode
+    unsigned long
+      refNumBase_ = 0;
+
+    PolicyPlugin
+      *plugin_ = NULL;
+
+    int 
+      totalCacheSize_,
+      lineSize_,
+      setSize_,
+      numberOfSets_,
+      indexSize_,
+      tagSize_,
+      offsetSize_,
+      totalHits = 0,
+      totalMiss = 0,
+      totalAccess = 0,
+      threads_ = 1;
+
+    SimEngine
+      engine_ = SimEngine::SERIAL;
+
+    // whether select_engine() picks the engine, and what it picked
+    bool
+      autoEngine_ = false;
+
+    std::string
+      engineChoice_;
+
+    InsertionPolicy
+      insertionPolicy_ = InsertionPolicy::MRU;
+
+    // BIP and DIP state. DIP dedicates every duelSpacing_th set, and the
+    // one after it, to leading with LRU and BIP insertion
+    unsigned int
+      bipState_ = 2463534242u,
+      bipThrottle_ = 32,
+      duelSpacing_ = 32,
+      psel_ = 512,
+      pselMax_ = 1023;
+
+    // loop fast-forwarding limits
+    size_t
+      loopMaxPeriod_ = 1024,
+      loopMinIterations_ = 2,
+      loopMaxWarmup_ = 8,
+      loopProbeInterval_ = 64;
+
+    unsigned long 
+      offsetMask_,
+      indexMask_,
+      tagMask_,
+      epoch_ = 0,
+      writebacks_ = 0,
+      backInvalidations_ = 0,
+      memoryReads_ = 0,
+      memoryWrites_ = 0;
+
+    bool
+      recordTraffic_ = false;
+
+    ConflictGraph
+      *conflictGraph_ = NULL;
+
+    size_t
+      conflictsShown_ = 0;
+
+    std::vector<unsigned long>
+      memoryTraffic_;
+
+    double
+      hitRate,
+      missRate;
+
+}; // end class CacheTable
+
+volatile sig_atomic_t CacheTable::followStopped_ = 0;
+
+
+class SparseDirectory
+{
+  /* a sparse coherence directory, or snoop filter, with a fixed number of
+  entries. it uses the same CacheSet and CacheLine storage as the data
+  caches, with each entry's sharers recording the cores holding the line.
+  every line in a private cache needs an entry, so when a set is full the
+  LRU entry is evicted and its line invalidated in every sharer. the
+  number of sets need not be a power of two, so a line's set is its line
+  number modulo the number of sets, and the quotient is its tag */
+
+  public:
+
+    SparseDirectory(int entries, int setSize, int lineSize)
+      : setSize_(setSize), numberOfSets_(std::max(1, entries / setSize)) {
+      offsetSize_ = log2(lineSize);
+      for (int i = 0; i < numberOfSets_; ++i) {
+        directorySet_.push_back(CacheSet(setSize_));
+        directorySet_.back().setIndex(i);
+      }
+    }
+
+    // returns the entry for the line at address, or NULL if no core holds
+    // it. a lookup counts as a use for the LRU order
+    CacheLine *find(unsigned long address) {
+      CacheSet &set = directory_set(address);
+      unsigned long tag = directory_tag(address);
+      if (!set.check_cache_lines(tag)) {
+        return NULL;
+      }
+      return set.find_line(tag);
+    }
+
+    // like find, but leaves the LRU order alone
+    CacheLine *peek(unsigned long address) {
+      return directory_set(address).find_line(directory_tag(address));
+    }
+
+    // adds an entry with no sharers for the line at address. if that
+    // evicts another entry, returns true and reports the evicted line's
+    // address and sharers
+    bool allocate(unsigned long address, unsigned long &victimAddress,
+        unsigned long &victimSharers) {
+      CacheSet &set = directory_set(address);
+      unsigned long tag = directory_tag(address);
+      CacheLine victim;
+      bool evicted = set.update_cache_lines(tag, &victim);
+      set.find_line(tag)->set_sharers(0);
+      if (evicted) {
+        unsigned long index = (address >> offsetSize_) % numberOfSets_;
+        victimAddress = (victim.getTag() * numberOfSets_ + index)
+          << offsetSize_;
+        victimSharers = victim.get_sharers();
+        evictions_++;
+      }
+      return evicted;
+    }
+
+    void remove(unsigned long address) {
+      bool wasDirty = false;
+      directory_set(address).invalidate_line(directory_tag(address),
+          wasDirty);
+    }
+
+    // drops every entry in O(1), like CacheTable::flush_cache
+    void flush() {
+      epoch_++;
+    }
+
+    int get_entries() {
+      return numberOfSets_ * setSize_;
+    }
+
+    int get_set_size() {
+      return setSize_;
+    }
+
+    unsigned long get_evictions() {
+      return evictions_;
+    }
+
+  private:
+
+    CacheSet &directory_set(unsigned long address) {
+      CacheSet &set = directorySet_[(address >> offsetSize_)
+        % numberOfSets_];
+      set.sync_epoch(epoch_);
+      return set;
+    }
+
+    unsigned long directory_tag(unsigned long address) {
+      return (address >> offsetSize_) / numberOfSets_;
+    }
+
+    int
+      setSize_,
+      numberOfSets_,
+      offsetSize_;
+
+    unsigned long
+      epoch_ = 0,
+      evictions_ = 0;
+
+    std::vector<CacheSet>
+      directorySet_;
+
+}; // end class SparseDirectory
+
+
+// how MultiCoreSystem assigns each page a home socket
+enum class HomePolicy {FIRST_TOUCH, INTERLEAVE};
+
+class MultiCoreSystem
+{
+  /* private caches for several cores, kept coherent by a sparse
+  directory. the core that made each reference comes from the optional
+  fourth field of the trace. writes invalidate the other sharers, and
+  directory evictions back-invalidate the private copies of their line.
+
+  the cores can be spread over several sockets, each with an optional
+  shared last level cache. a private miss is served by the socket's LLC,
+  then by a cache on another socket holding the line, and then by memory,
+  which is local or remote depending on the home socket of the page */
+
+  public:
+
+    // at most 64 cores, one per bit of a directory entry's sharers
+    MultiCoreSystem(int cores, int sockets = 1)
+      : cores_(std::min(std::max(cores, 1), 64)),
+      sockets_(std::min(std::max(sockets, 1), cores_)),
+      coherenceInvalidations_(cores_, 0), directoryInvalidations_(cores_, 0),
+      llcHits_(cores_, 0), localMemory_(cores_, 0), remoteMemory_(cores_, 0),
+      remoteTransfers_(cores_, 0) {}
+
+    ~MultiCoreSystem() {
+      for (std::vector<CacheTable*>::iterator it = privateCache_.begin();
+          it != privateCache_.end(); ++it) {
+        delete *it;
+      }
+      for (std::vector<CacheTable*>::iterator it = socketCache_.begin();
+          it != socketCache_.end(); ++it) {
+        delete *it;
+      }
+      delete directory_;
+    }
+
+    // gives every socket a shared last level cache
+    int configure_llc(char* filename) {
+      for (int s = 0; s < sockets_; ++s) {
+        socketCache_.push_back(new CacheTable);
+        if (socketCache_.back()->configure(filename) != 0) {
+          return 1;
+        }
+      }
+      return 0;
+    }
+
+    // pages are pageSize bytes, and the remote access report groups them
+    // into regions of regionSize bytes. both must be powers of two
+    void set_numa(HomePolicy homePolicy, unsigned long pageSize,
+        unsigned long regionSize) {
+      homePolicy_ = homePolicy;
+      pageBits_ = log2(pageSize);
+      regionBits_ = log2(regionSize);
+    }
+
+    // gives every core a cache built from the same configuration file.
+    // without an explicit size, the directory gets twice as many entries
+    // as there are private lines, with twice their associativity
+    int configure(char* filename, int directoryEntries, int directorySetSize) {
+      for (int c = 0; c < cores_; ++c) {
+        privateCache_.push_back(new CacheTable);
+        if (privateCache_.back()->configure(filename) != 0) {
+          return 1;
+        }
+      }
+      CacheTable *first = privateCache_.front();
+      lineSize_ = first->get_line_size();
+      if (directoryEntries <= 0) {
+        directoryEntries = 2 * cores_ * (first->get_total_cache_size() / lineSize_);
+        directorySetSize = 2 * first->get_set_size();
+      }
+      directory_ = new SparseDirectory(directoryEntries,
+          std::max(1, directorySetSize), lineSize_);
+      return 0;
+    }
+
+    // runs the decoded trace of cacheTable, setting hit or miss for each
+    // reference from the point of view of the core that made it
+    void simulate(CacheTable &cacheTable) {
+      std::vector<MemRef> &memRefs = cacheTable.get_mem_refs();
+      for (std::vector<MemRef>::iterator it = memRefs.begin();
+          it != memRefs.end(); ++it) {
+        if (cacheTable.is_flush(*it)) {
+          for (int c = 0; c < cores_; ++c) {
+            privateCache_[c]->flush_cache();
+          }
+          for (size_t s = 0; s < socketCache_.size(); ++s) {
+            socketCache_[s]->flush_cache();
+          }
+          directory_->flush();
+        } else if (it->getRW() == ReadOrWrite::INVALIDATE) {
+          unsigned long lineAddress = it->getAddress() & ~(lineSize_ - 1UL);
+          invalidate_sharers(lineAddress, ~0UL, NULL);
+          directory_->remove(lineAddress);
+          for (size_t s = 0; s < socketCache_.size(); ++s) {
+            socketCache_[s]->invalidate_address(
+                socketCache_[s]->index_of(lineAddress),
+                socketCache_[s]->tag_of(lineAddress));
+          }
+        } else if (it->is_access()) {
+          // unsigned, so a core number can never map below core 0
+          it->setHM(access((unsigned)it->getCore() % (unsigned)cores_, *it));
+        }
+      }
+    }
+
+    void print_summary() {
+      std::cout << "\n";
+      std::cout << "    Multicore Summary\n";
+      std::cout << "**************************\n";
+      std::cout << "Directory Entries:\t" << directory_->get_entries() << "\n";
+      std::cout << "Directory Set Size:\t" << directory_->get_set_size() << "\n";
+      std::cout << "Directory Evictions:\t" << directory_->get_evictions() << "\n";
+
+      unsigned long directoryInvalidations = 0;
+      for (int c = 0; c < cores_; ++c) {
+        directoryInvalidations += directoryInvalidations_[c];
+      }
+      std::cout << "Directory-Induced Invalidations:\t"
+        << directoryInvalidations << "\n\n";
+
+      std::cout << std::setw(6)  << std::left << "Core"
+        << std::setw(10) << "Accesses"
+        << std::setw(10) << "Hits"
+        << std::setw(10) << "Misses"
+        << std::setw(14) << "Coherence Inv"
+        << std::setw(14) << "Directory Inv";
+      std::cout << std::setfill('*') << std::setw(65) << "\n" << std::setfill(' ');
+      std::cout << "\n";
+      for (int c = 0; c < cores_; ++c) {
+        std::cout << std::setw(6) << c
+          << std::setw(10) << privateCache_[c]->get_total_hits()
+            + privateCache_[c]->get_total_misses()
+          << std::setw(10) << privateCache_[c]->get_total_hits()
+          << std::setw(10) << privateCache_[c]->get_total_misses()
+          << std::setw(14) << coherenceInvalidations_[c]
+          << std::setw(14) << directoryInvalidations_[c] << "\n";
+      }
+    }
+
+    void print_numa_summary() {
+      std::cout << "\n";
+      std::cout << "      NUMA Summary\n";
+      std::cout << "**************************\n";
+      std::cout << "Sockets:\t" << sockets_ << "\n";
+      std::cout << "Home Policy:\t" << (homePolicy_ == HomePolicy::INTERLEAVE
+          ? "interleave" : "first-touch") << "\n\n";
+
+      std::cout << std::setw(6)  << std::left << "Core"
+        << std::setw(8)  << "Socket"
+        << std::setw(10) << "LLC Hits"
+        << std::setw(10) << "Local"
+        << std::setw(10) << "Remote"
+        << std::setw(12) << "X-Socket"
+        << std::setw(12) << "Remote %";
+      std::cout << std::setfill('*') << std::setw(69) << "\n" << std::setfill(' ');
+      std::cout << "\n";
+      for (int c = 0; c < cores_; ++c) {
+        std::cout << std::setw(6) << c
+          << std::setw(8)  << socket_of(c)
+          << std::setw(10) << llcHits_[c]
+          << std::setw(10) << localMemory_[c]
+          << std::setw(10) << remoteMemory_[c]
+          << std::setw(12) << remoteTransfers_[c]
+          << std::setw(12) << std::setprecision(4)
+          << percent(remoteMemory_[c], localMemory_[c] + remoteMemory_[c])
+          << "\n";
+      }
+
+      // the regions with the most remote memory accesses
+      std::vector< std::pair<unsigned long, std::pair<unsigned long,
+        unsigned long> > > regions(regionAccesses_.begin(),
+            regionAccesses_.end());
+      std::sort(regions.begin(), regions.end(),
+          [](const std::pair<unsigned long, std::pair<unsigned long,
+            unsigned long> > &a, const std::pair<unsigned long,
+            std::pair<unsigned long, unsigned long> > &b) {
+            return a.second.second > b.second.second
+              || (a.second.second == b.second.second && a.first < b.first);
+          });
+      std::cout << "\n";
+      std::cout << std::setw(20) << "Region"
+        << std::setw(10) << "Local"
+        << std::setw(10) << "Remote"
+        << std::setw(12) << "Remote %";
+      std::cout << std::setfill('*') << std::setw(53) << "\n" << std::setfill(' ');
+      std::cout << "\n";
+      for (size_t i = 0; i < regions.size() && i < regionsShown_; ++i) {
+        std::cout << "0x" << std::setw(18) << std::hex
+          << (regions[i].first << regionBits_) << std::dec
+          << std::setw(10) << regions[i].second.first
+          << std::setw(10) << regions[i].second.second
+          << std::setw(12) << percent(regions[i].second.second,
+              regions[i].second.first + regions[i].second.second) << "\n";
+      }
+    }
+
+  private:
+
+    // one read or write by core
+    bool access(int core, MemRef &memRef) {
+      unsigned long lineAddress = memRef.getAddress() & ~(lineSize_ - 1UL);
+      unsigned long coreBit = 1UL << core;
+      bool write = memRef.getRW() == ReadOrWrite::WRITE;
+
+      // the directory entry has to exist before the line can be cached.
+      // allocating it may evict another entry, taking its line out of
+      // every private cache that held it
+      CacheLine *entry = directory_->find(lineAddress);
+      unsigned long otherSharers = 0;
+      if (entry != NULL) {
+        otherSharers = entry->get_sharers() & ~coreBit;
+      } else {
+        unsigned long victimAddress = 0;
+        unsigned long victimSharers = 0;
+        if (directory_->allocate(lineAddress, victimAddress, victimSharers)) {
+          invalidate_sharers(victimAddress, victimSharers,
+              &directoryInvalidations_);
+        }
+        entry = directory_->peek(lineAddress);
+      }
+
+      // a write leaves the writer as the only sharer
+      if (write && (entry->get_sharers() & ~coreBit) != 0) {
+        invalidate_sharers(lineAddress, entry->get_sharers() & ~coreBit,
+            &coherenceInvalidations_);
+        entry->set_sharers(0);
+      }
+      entry->set_sharers(entry->get_sharers() | coreBit);
+
+      CacheLine victim;
+      bool evicted = false;
+      bool hit = privateCache_[core]->access_line(memRef.getIndex(),
+          memRef.getTag(), write, victim, evicted);
+      if (!hit) {
+        serve_miss(core, lineAddress, otherSharers);
+      }
+
+      // the line the fill pushed out no longer needs this core's bit
+      if (evicted) {
+        unsigned long victimAddress = privateCache_[core]->line_address(
+            memRef.getIndex(), victim.getTag());
+        CacheLine *victimEntry = directory_->peek(victimAddress);
+        if (victimEntry != NULL) {
+          victimEntry->set_sharers(victimEntry->get_sharers() & ~coreBit);
+          if (victimEntry->get_sharers() == 0) {
+            directory_->remove(victimAddress);
+          }
+        }
+      }
+      return hit;
+    }
+
+    int socket_of(int core) {
+      return core * sockets_ / cores_;
+    }
+
+    // works out where a private miss is served from: the socket's LLC,
+    // another socket's caches, or local or remote memory
+    void serve_miss(int core, unsigned long lineAddress,
+        unsigned long otherSharers) {
+      int socket = socket_of(core);
+      if (!socketCache_.empty()) {
+        CacheTable *llc = socketCache_[socket];
+        CacheLine victim;
+        bool evicted = false;
+        if (llc->access_line(llc->index_of(lineAddress),
+              llc->tag_of(lineAddress), false, victim, evicted)) {
+          llcHits_[core]++;
+          return;
+        }
+      }
+
+      // another socket holding the line forwards it
+      bool remoteCopy = false;
+      for (int c = 0; c < cores_ && !remoteCopy; ++c) {
+        remoteCopy = (otherSharers & (1UL << c)) && socket_of(c) != socket;
+      }
+      for (size_t s = 0; s < socketCache_.size() && !remoteCopy; ++s) {
+        CacheTable *llc = socketCache_[s];
+        remoteCopy = (int)s != socket && llc->holds_line(
+            llc->index_of(lineAddress), llc->tag_of(lineAddress));
+      }
+      if (remoteCopy) {
+        remoteTransfers_[core]++;
+        return;
+      }
+
+      unsigned long page = lineAddress >> pageBits_;
+      int home = socket;
+      if (homePolicy_ == HomePolicy::INTERLEAVE) {
+        home = page % sockets_;
+      } else {
+        // first touch: the page lives wherever it was first missed on
+        std::unordered_map<unsigned long, int>::iterator it = pageHome_.find(page);
+        if (it == pageHome_.end()) {
+          pageHome_[page] = socket;
+        } else {
+          home = it->second;
+        }
+      }
+
+      std::pair<unsigned long, unsigned long> &region =
+        regionAccesses_[lineAddress >> regionBits_];
+      if (home == socket) {
+        localMemory_[core]++;
+        region.first++;
+      } else {
+        remoteMemory_[core]++;
+        region.second++;
+      }
+    }
+
+    static double percent(unsigned long part, unsigned long whole) {
+      return whole == 0 ? 0 : 100.0 * part / whole;
+    }
+
+    // drops the line at lineAddress from every core in sharers, counting
+    // each copy that was actually present in counts
+    void invalidate_sharers(unsigned long lineAddress, unsigned long sharers,
+        std::vector<unsigned long> *counts) {
+      for (int c = 0; c < cores_; ++c) {
+        if (!(sharers & (1UL << c))) {
+          continue;
+        }
+        CacheTable *cache = privateCache_[c];
+        unsigned long index = cache->index_of(lineAddress);
+        unsigned long tag = cache->tag_of(lineAddress);
+        if (cache->holds_line(index, tag)) {
+          cache->invalidate_address(index, tag);
+          if (counts != NULL) {
+            (*counts)[c]++;
+          }
+        }
+      }
+    }
+
+    int
+      cores_,
+      sockets_,
+      lineSize_ = 0;
+
+    std::vector<CacheTable*>
+      privateCache_,
+      socketCache_;
+
+    HomePolicy
+      homePolicy_ = HomePolicy::FIRST_TOUCH;
+
+    unsigned long
+      pageBits_ = 12,
+      regionBits_ = 20;
+
+    size_t
+      regionsShown_ = 10;
+
+    // home socket of every page touched so far, for first touch
+    std::unordered_map<unsigned long, int>
+      pageHome_;
+
+    // local and remote memory accesses for each region
+    std::map<unsigned long, std::pair<unsigned long, unsigned long> >
+      regionAccesses_;
+
+    SparseDirectory
+      *directory_ = NULL;
+
+    std::vector<unsigned long>
+      coherenceInvalidations_,
+      directoryInvalidations_,
+      llcHits_,
+      localMemory_,
+      remoteMemory_,
+      remoteTransfers_;
+
+}; // end class MultiCoreSystem
+
+class ConcurrentCacheTable
+{
+  /* a cache table that many threads can access at once, for simulating
+  inside instrumented multithreaded programs. every set has its own
+  spinlock and counters, so threads only contend when they touch the same
+  set. with globalLock set, one mutex guards the whole table instead,
+  which is useful as a baseline for the stress benchmark */
+
+  public:
+
+    ConcurrentCacheTable(int totalCacheSize, int lineSize, int setSize,
+        bool globalLock = false)
+      : numberOfSets_((totalCacheSize / lineSize) / setSize),
+      globalLock_(globalLock), sets_(numberOfSets_) {
+      offsetSize_ = log2(lineSize);
+      indexSize_ = log2(numberOfSets_);
+      for (int i = 0; i < numberOfSets_; ++i) {
+        sets_[i].cacheSet = CacheSet(setSize);
+        sets_[i].cacheSet.setIndex(i);
+      }
+    }
+
+    // looks up the line holding address, filling it on a miss. safe to
+    // call from any number of threads
+    bool access(unsigned long address) {
+      unsigned long index = (address >> offsetSize_) & (numberOfSets_ - 1);
+      unsigned long tag = address >> (indexSize_ + offsetSize_);
+      LockedSet &set = sets_[index];
+
+      if (globalLock_) {
+        tableMutex_.lock();
+      } else {
+        while (set.lock.test_and_set(std::memory_order_acquire)) {
+          std::this_thread::yield();
+        }
+      }
+
+      bool hit = set.cacheSet.check_cache_lines(tag);
+      if (hit) {
+        set.hits++;
+      } else {
+        set.cacheSet.update_cache_lines(tag);
+        set.misses++;
+      }
+
+      if (globalLock_) {
+        tableMutex_.unlock();
+      } else {
+        set.lock.clear(std::memory_order_release);
+      }
+      return hit;
+    }
+
+    // the totals are only exact once the producers have stopped
+    unsigned long get_total_hits() {
+      unsigned long hits = 0;
+      for (std::vector<LockedSet>::iterator it = sets_.begin();
+          it != sets_.end(); ++it) {
+        hits += it->hits;
+      }
+      return hits;
+    }
+
+    unsigned long get_total_misses() {
+      unsigned long misses = 0;
+      for (std::vector<LockedSet>::iterator it = sets_.begin();
+          it != sets_.end(); ++it) {
+        misses += it->misses;
+      }
+      return misses;
+    }
+
+  private:
+
+    // padded to a line of its own so neighbouring sets don't false share
+    struct alignas(64) LockedSet {
+      std::atomic_flag lock = ATOMIC_FLAG_INIT;
+      CacheSet cacheSet = CacheSet(0);
+      unsigned long hits = 0;
+      unsigned long misses = 0;
+
+      LockedSet() {}
+      LockedSet(const LockedSet &other)
+        : cacheSet(other.cacheSet), hits(other.hits), misses(other.misses) {}
+    };
+
+    int
+      numberOfSets_,
+      offsetSize_,
+      indexSize_;
+
+    bool
+      globalLock_;
+
+    std::vector<LockedSet>
+      sets_;
+
+    std::mutex
+      tableMutex_;
+
+}; // end class ConcurrentCacheTable
+
+
+// replays the decoded trace from several threads into one shared
+// ConcurrentCacheTable, first with per-set locks and then with a global
+// mutex, and prints the throughput of each for 1, 2, 4 ... maxThreads
+void run_stress_benchmark(CacheTable &cacheTable, int maxThreads) {
+  std::vector<MemRef> &memRefs = cacheTable.get_mem_refs();
+
+  std::cout << std::setw(10) << std::left << "Threads"
+    << std::setw(18) << "Per-Set Mref/s"
+    << std::setw(18) << "Global Mref/s";
+  std::cout << std::setfill('*') << std::setw(46) << "\n" << std::setfill(' ');
+  std::cout << "\n";
+
+  for (int threads = 1; threads <= maxThreads; threads *= 2) {
+    std::cout << std::setw(10) << std::left << threads;
+    for (int globalLock = 0; globalLock <= 1; ++globalLock) {
+      ConcurrentCacheTable table(cacheTable.get_total_cache_size(),
+          cacheTable.get_line_size(), cacheTable.get_set_size(), globalLock);
+
+      // every producer replays the whole trace, offset so the threads
+      // share sets but not lines
+      std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+      std::vector<std::thread> producers;
+      for (int t = 0; t < threads; ++t) {
+        producers.push_back(std::thread([&table, &memRefs, t]() {
+          unsigned long threadOffset = (unsigned long)t << 40;
+          for (std::vector<MemRef>::iterator it = memRefs.begin();
+              it != memRefs.end(); ++it) {
+            if (!it->is_access()) {
+              continue;
+            }
+            table.access(it->getAddress() + threadOffset);
+          }
+        }));
+      }
+      for (std::vector<std::thread>::iterator it = producers.begin();
+          it != producers.end(); ++it) {
+        it->join();
+      }
+      std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+      double rate = (double)memRefs.size() * threads / elapsed.count() / 1e6;
+      std::cout << std::setw(18) << std::fixed << std::setprecision(2) << rate;
+    }
+    std::cout << "\n";
+  }
+}
+
+// the benchmark kernel for run_emitter_benchmark: refs references to a
+// 512KB array in a scrambled order, half reads and half writes, each
+// recorded in emitter if Emit
+template <bool Emit>
+unsigned long emitter_workload(unsigned long refs,
+    cachetrace::Emitter *emitter) {
+  const unsigned long mask = (1 << 16) - 1;
+  std::vector<unsigned long> data(mask + 1, 1);
+  unsigned long sum = 0;
+  for (unsigned long r = 0; r < refs / 2; ++r) {
+    unsigned long *read = &data[(r * 2654435761UL) & mask];
+    unsigned long *write = &data[(r * 40503UL) & mask];
+    sum += *read;
+    if (Emit) {
+      emitter->read(read, sizeof(*read));
+    }
+    *write = sum;
+    if (Emit) {
+      emitter->write(write, sizeof(*write));
+    }
+  }
+  return sum;
+}
+
+// measures what recording a trace with cacheTraceEmitter.hpp costs a
+// program: every thread runs the same kernel without and then with an
+// emitter, and the trace it wrote is simulated to check it is complete
+void run_emitter_benchmark(CacheTable &cacheTable, unsigned long refs,
+    int threads) {
+  char filename[] = "/tmp/cacheSimEmitXXXXXX";
+  int fd = mkstemp(filename);
+  if (fd < 0) {
+    std::cerr << "\nError: cannot create a temporary trace file\n"
+      << std::endl;
+    return;
+  }
+  close(fd);
+
+  double seconds[2];
+  // each thread keeps its kernel's result in its own slot, and the sink
+  // stops the compiler from dropping the kernels
+  std::vector<unsigned long> sums(threads, 0);
+  volatile unsigned long sink = 0;
+  cachetrace::Emitter emitter(filename);
+  for (int emit = 0; emit <= 1; ++emit) {
+    std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+      workers.push_back(std::thread([&sums, &emitter, refs, emit, t]() {
+        sums[t] = emit ? emitter_workload<true>(refs, &emitter)
+          : emitter_workload<false>(refs, NULL);
+      }));
+    }
+    for (std::vector<std::thread>::iterator it = workers.begin();
+        it != workers.end(); ++it) {
+      it->join();
+    }
+    std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+    seconds[emit] = elapsed.count();
+    for (int t = 0; t < threads; ++t) {
+      sink = sink + sums[t];
+    }
+  }
+  emitter.close();
+
+  struct stat status;
+  stat(filename, &status);
+  double perRef = 1e9 / (refs / 2 * 2);
+  std::cout << "\n  Trace Emitter Benchmark\n";
+  std::cout << "**************************\n";
+  std::cout << "Threads:\t" << threads << "\n";
+  std::cout << "References:\t" << refs / 2 * 2 * threads << "\n";
+  std::cout << std::fixed << std::setprecision(2);
+  std::cout << "Without (ns/ref):\t" << seconds[0] * perRef << "\n";
+  std::cout << "With (ns/ref):\t\t" << seconds[1] * perRef << "\n";
+  std::cout << "Overhead (ns/ref):\t" << (seconds[1] - seconds[0]) * perRef
+    << "\n";
+  std::cout << "Trace Size:\t" << status.st_size / 1048576.0 << "MB\n";
+  std::cout.unsetf(std::ios::fixed);
+
+  // the emitted trace, as the simulator sees it. every reference must
+  // have reached it, as a record or merged into a buffered write
+  unsigned long emitted = refs / 2 * 2 * threads;
+  if (cacheTable.read_mem_trace(filename) == 0) {
+    unsigned long decoded = cacheTable.get_mem_refs().size()
+      + cacheTable.get_writes_combined();
+    if (decoded != emitted) {
+      std::cerr << "\nError: the trace holds " << decoded
+        << " references, but " << emitted << " were emitted\n" << std::endl;
+    }
+    cacheTable.print_summary(false);
+  }
+  unlink(filename);
+}
+
+class RandomReplacementEnsemble
+{
+  /* simulates many replicas of the cache with random replacement, each
+  with its own xoshiro256** generator. the replicas step through the
+  decoded trace together, and all per-replica state is stored with the
+  replica as the innermost index, so the work for one reference is a few
+  loops over contiguous arrays that the compiler vectorizes with one
+  replica per SIMD lane */
+
+  public:
+
+    // seeds each replica's generator from seed + its position
+    RandomReplacementEnsemble(int numberOfSets, int setSize, int replicas,
+        unsigned long seed, bool switchFlushes)
+      : setSize_(setSize), replicas_(replicas), switchFlushes_(switchFlushes),
+      tags_((size_t)numberOfSets * setSize * replicas, ~0UL),
+      hits_(replicas, 0), s0_(replicas), s1_(replicas), s2_(replicas),
+      s3_(replicas), filled_((size_t)numberOfSets * replicas, 0) {
+      for (int r = 0; r < replicas_; ++r) {
+        unsigned long x = seed + r;
+        s0_[r] = splitmix64(x);
+        s1_[r] = splitmix64(x);
+        s2_[r] = splitmix64(x);
+        s3_[r] = splitmix64(x);
+      }
+    }
+
+    // runs every replica over the decoded trace
+    void run(std::vector<MemRef> &memRefs) {
+      std::vector<unsigned long> random(replicas_);
+      std::vector<unsigned char> hit(replicas_);
+
+      for (std::vector<MemRef>::iterator it = memRefs.begin();
+          it != memRefs.end(); ++it) {
+        unsigned long tag = it->getTag();
+        size_t set = it->getIndex();
+        unsigned long *tags = &tags_[set * setSize_ * replicas_];
+        unsigned int *filled = &filled_[set * replicas_];
+
+        if (it->getRW() == ReadOrWrite::FLUSH
+            || (it->getRW() == ReadOrWrite::SWITCH && switchFlushes_)) {
+          std::fill(tags_.begin(), tags_.end(), ~0UL);
+          std::fill(filled_.begin(), filled_.end(), 0);
+          continue;
+        } else if (it->getRW() == ReadOrWrite::INVALIDATE) {
+          invalidate(tags, filled, tag);
+          continue;
+        } else if (!it->is_access()) {
+          continue;
+        }
+
+        std::fill(hit.begin(), hit.end(), 0);
+        for (int w = 0; w < setSize_; ++w) {
+          unsigned long *wayTags = tags + (size_t)w * replicas_;
+          for (int r = 0; r < replicas_; ++r) {
+            hit[r] |= (wayTags[r] == tag);
+          }
+        }
+
+        next_random(random);
+        for (int r = 0; r < replicas_; ++r) {
+          hits_[r] += hit[r];
+        }
+
+        // misses fill an empty way, or replace a random one
+        for (int r = 0; r < replicas_; ++r) {
+          if (!hit[r]) {
+            unsigned int way = filled[r] < (unsigned int)setSize_ ? filled[r]++
+              : (unsigned int)(((random[r] >> 32) * setSize_) >> 32);
+            tags[(size_t)way * replicas_ + r] = tag;
+          }
+        }
+      }
+    }
+
+    unsigned long get_hits(int replica) {
+      return hits_[replica];
+    }
+
+  private:
+
+    // drops tag from one set in every replica, moving the last filled way
+    // into the hole so the filled ways stay contiguous
+    void invalidate(unsigned long *tags, unsigned int *filled,
+        unsigned long tag) {
+      for (int r = 0; r < replicas_; ++r) {
+        for (unsigned int w = 0; w < filled[r]; ++w) {
+          if (tags[(size_t)w * replicas_ + r] == tag) {
+            unsigned int last = --filled[r];
+            tags[(size_t)w * replicas_ + r] = tags[(size_t)last * replicas_ + r];
+            tags[(size_t)last * replicas_ + r] = ~0UL;
+            break;
+          }
+        }
+      }
+    }
+
+    // one xoshiro256** step for every replica
+    void next_random(std::vector<unsigned long> &random) {
+      for (int r = 0; r < replicas_; ++r) {
+        random[r] = rotl(s1_[r] * 5, 7) * 9;
+        unsigned long t = s1_[r] << 17;
+        s2_[r] ^= s0_[r];
+        s3_[r] ^= s1_[r];
+        s1_[r] ^= s2_[r];
+        s0_[r] ^= s3_[r];
+        s2_[r] ^= t;
+        s3_[r] = rotl(s3_[r], 45);
+      }
+    }
+
+    static unsigned long rotl(unsigned long x, int k) {
+      return (x << k) | (x >> (64 - k));
+    }
+
+    // expands a seed into generator state
+    static unsigned long splitmix64(unsigned long &x) {
+      unsigned long z = (x += 0x9e3779b97f4a7c15UL);
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9UL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebUL;
+      return z ^ (z >> 31);
+    }
+
+    int
+      setSize_,
+      replicas_;
+
+    // whether an address space switch flushes the cache
+    bool
+      switchFlushes_;
+
+    // tags_[(set * setSize + way) * replicas + replica]
+    std::vector<unsigned long>
+      tags_,
+      hits_,
+      s0_,
+      s1_,
+      s2_,
+      s3_;
+
+    // ways in use, filled_[set * replicas + replica]
+    std::vector<unsigned int>
+      filled_;
+
+}; // end class RandomReplacementEnsemble
+
+
+// runs replicas copies of the cache with random replacement, spread over
+// threads, and prints the distribution of their hit rates
+void run_random_replacement(CacheTable &cacheTable, int replicas,
+    unsigned long seed, int threads) {
+  std::vector<MemRef> &memRefs = cacheTable.get_mem_refs();
+  threads = std::max(1, std::min(threads, replicas));
+
+  // each thread gets a contiguous group of replicas
+  std::vector<RandomReplacementEnsemble*> ensembles;
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; ++t) {
+    int first = (long)replicas * t / threads;
+    int last = (long)replicas * (t + 1) / threads;
+    ensembles.push_back(new RandomReplacementEnsemble(
+          cacheTable.get_number_of_sets(), cacheTable.get_set_size(),
+          last - first, seed + first, !cacheTable.is_translated()));
+    workers.push_back(std::thread(&RandomReplacementEnsemble::run,
+          ensembles.back(), std::ref(memRefs)));
+  }
+
+  unsigned long accesses = 0;
+  for (std::vector<MemRef>::iterator it = memRefs.begin();
+      it != memRefs.end(); ++it) {
+    if (it->is_access()) {
+      accesses++;
+    }
+  }
+
+  std::vector<double> hitRates;
+  for (int t = 0; t < threads; ++t) {
+    workers[t].join();
+    int count = (long)replicas * (t + 1) / threads - (long)replicas * t / threads;
+    for (int r = 0; r < count; ++r) {
+      hitRates.push_back(accesses
+          ? (double)ensembles[t]->get_hits(r) / accesses : 0.0);
+    }
+    delete ensembles[t];
+  }
+  std::sort(hitRates.begin(), hitRates.end());
+
+  double mean = 0;
+  for (std::vector<double>::iterator it = hitRates.begin();
+      it != hitRates.end(); ++it) {
+    mean += *it;
+  }
+  mean /= hitRates.size();
+  double variance = 0;
+  for (std::vector<double>::iterator it = hitRates.begin();
+      it != hitRates.end(); ++it) {
+    variance += (*it - mean) * (*it - mean);
+  }
+  variance /= hitRates.size();
+
+  cacheTable.print_configuration();
+  std::cout << "  Random Replacement Summary\n";
+  std::cout << "******************************\n";
+  std::cout << "Replicas:\t"       << replicas << "\n";
+  std::cout << "References:\t"     << accesses << "\n";
+  std::cout << std::setprecision(5);
+  std::cout << "Mean Hit Rate:\t"  << mean << "\n";
+  std::cout << "Std Deviation:\t"  << sqrt(variance) << "\n";
+  std::cout << "Min Hit Rate:\t"   << hitRates.front() << "\n";
+  std::cout << "5th Percentile:\t" << hitRates[hitRates.size() * 5 / 100] << "\n";
+  std::cout << "Median:\t\t"       << hitRates[hitRates.size() / 2] << "\n";
+  std::cout << "95th Percentile:\t" << hitRates[hitRates.size() * 95 / 100] << "\n";
+  std::cout << "Max Hit Rate:\t"   << hitRates.back() << "\n";
+}
+
+class StackDistanceProfile
+{
+  /* simulates LRU caches of every associativity from 1 to maxWays in one
+  pass, keeping the table's sets and line size. each set keeps a Mattson
+  stack of its lines, most recent first, and a reference found at depth d
+  hits in every cache with more than d ways.
+
+  the same stacks give the writebacks. a write starts a dirty epoch for
+  its line, which remembers the deepest position the line is pushed to
+  before its next write. a cache with w ways evicts the line, and writes
+  it back, once it reaches depth w, and the line stays clean until it is
+  written again, so an epoch that got m deep costs one writeback in every
+  cache of at most m ways. lines falling off the bottom of the stack, and
+  flushes and invalidates, write back every dirty epoch they end in
+  every cache. an invalidated line leaves a hole in its stack, the empty
+  way it frees in the deeper caches, which the next line pushed down
+  fills */
+
+  public:
+
+    StackDistanceProfile(int numberOfSets, int maxWays, bool switchFlushes)
+      : numberOfSets_(numberOfSets), maxWays_(maxWays),
+      switchFlushes_(switchFlushes), hits_(maxWays, 0),
+      writebacks_(maxWays + 1, 0) {}
+
+    // runs the sets whose index is part modulo parts, so several profiles
+    // can share the trace
+    void run(std::vector<MemRef> &memRefs, int part, int parts) {
+      std::vector< std::vector<StackEntry> > stacks(numberOfSets_);
+
+      for (std::vector<MemRef>::iterator it = memRefs.begin();
+          it != memRefs.end(); ++it) {
+        if (it->getRW() == ReadOrWrite::FLUSH
+            || (it->getRW() == ReadOrWrite::SWITCH && switchFlushes_)) {
+          for (int set = part; set < numberOfSets_; set += parts) {
+            for (size_t d = 0; d < stacks[set].size(); ++d) {
+              stacks[set][d].maxDepth = maxWays_;
+              end_epoch(stacks[set][d]);
+            }
+            stacks[set].clear();
+          }
+          continue;
+        } else if (it->getRW() == ReadOrWrite::SWITCH
+            || it->getIndex() % parts != part) {
+          continue;
+        }
+
+        // finds the line, and the first hole above it
+        std::vector<StackEntry> &stack = stacks[it->getIndex()];
+        unsigned long tag = it->getTag();
+        size_t depth = 0;
+        size_t hole = stack.size();
+        while (depth < stack.size()
+            && (stack[depth].hole || stack[depth].tag != tag)) {
+          if (stack[depth].hole && hole == stack.size()) {
+            hole = depth;
+          }
+          depth++;
+        }
+
+        if (it->getRW() == ReadOrWrite::INVALIDATE) {
+          // the line leaves a hole, which is an empty way in every cache
+          // deeper than it was
+          if (depth < stack.size()) {
+            stack[depth].maxDepth = maxWays_;
+            end_epoch(stack[depth]);
+            stack[depth].hole = true;
+          }
+          continue;
+        } else if (!it->is_access()) {
+          continue;
+        }
+
+        accesses_++;
+        StackEntry entry = {tag, 0, false, false};
+        size_t vacated = std::min(depth, hole);
+        if (depth < stack.size()) {
+          hits_[depth]++;
+          entry = stack[depth];
+          if (hole < depth) {
+            // caches that hit keep their empty way where the line was
+            stack[depth].hole = true;
+            stack[depth].dirty = false;
+          }
+        } else if (vacated == stack.size()) {
+          if (stack.size() == (size_t)maxWays_) {
+            // the bottom line is pushed out of every cache
+            stack.back().maxDepth = maxWays_;
+            end_epoch(stack.back());
+            vacated--;
+          } else {
+            stack.push_back(entry);
+          }
+        }
+
+        // the lines above the vacated place move down one
+        for (size_t d = vacated; d > 0; --d) {
+          stack[d] = stack[d - 1];
+          stack[d].maxDepth = std::max(stack[d].maxDepth, (int)d);
+        }
+
+        if (it->getRW() == ReadOrWrite::WRITE) {
+          end_epoch(entry);
+          entry.dirty = true;
+          entry.maxDepth = 0;
+        }
+        stack[0] = entry;
+      }
+
+      // epochs still open at the end were only written back by the caches
+      // that evicted the line
+      for (int set = part; set < numberOfSets_; set += parts) {
+        for (size_t d = 0; d < stacks[set].size(); ++d) {
+          end_epoch(stacks[set][d]);
+        }
+      }
+    }
+
+    // adds the counts of a profile that ran other sets
+    void merge(StackDistanceProfile &other) {
+      accesses_ += other.accesses_;
+      for (int d = 0; d < maxWays_; ++d) {
+        hits_[d] += other.hits_[d];
+      }
+      for (int d = 0; d <= maxWays_; ++d) {
+        writebacks_[d] += other.writebacks_[d];
+      }
+    }
+
+    unsigned long get_accesses() {
+      return accesses_;
+    }
+
+    unsigned long get_misses(int ways) {
+      unsigned long misses = accesses_;
+      for (int d = 0; d < ways; ++d) {
+        misses -= hits_[d];
+      }
+      return misses;
+    }
+
+    unsigned long get_writebacks(int ways) {
+      unsigned long writebacks = 0;
+      for (int d = ways; d <= maxWays_; ++d) {
+        writebacks += writebacks_[d];
+      }
+      return writebacks;
+    }
+
+  private:
+
+    struct StackEntry {
+      unsigned long
+        tag;
+
+      // deepest position since the last write, maxWays_ once the line has
+      // been written back by every cache
+      int
+        maxDepth;
+
+      bool
+        dirty,
+        hole;
+    };
+
+    // counts the writebacks of the line's dirty epoch, if it has one
+    void end_epoch(StackEntry &entry) {
+      if (entry.dirty) {
+        writebacks_[entry.maxDepth]++;
+        entry.dirty = false;
+      }
+    }
+
+    int
+      numberOfSets_,
+      maxWays_;
+
+    // whether an address space switch flushes the cache
+    bool
+      switchFlushes_;
+
+    unsigned long
+      accesses_ = 0;
+
+    // hits_[d] counts references found at stack depth d
+    std::vector<unsigned long>
+      hits_;
+
+    // writebacks_[m] counts dirty epochs that reached depth m
+    std::vector<unsigned long>
+      writebacks_;
+
+}; // end class StackDistanceProfile
+
+
+// prints the misses and writebacks of LRU caches with 1 to maxWays ways,
+// splitting the sets over threads
+void run_stack_distance_profile(CacheTable &cacheTable, int maxWays,
+    int threads) {
+  std::vector<MemRef> &memRefs = cacheTable.get_mem_refs();
+  int numberOfSets = cacheTable.get_number_of_sets();
+  threads = std::max(1, std::min(threads, numberOfSets));
+
+  std::vector<StackDistanceProfile*> profiles;
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; ++t) {
+    profiles.push_back(new StackDistanceProfile(numberOfSets, maxWays,
+          !cacheTable.is_translated()));
+    workers.push_back(std::thread(&StackDistanceProfile::run,
+          profiles.back(), std::ref(memRefs), t, threads));
+  }
+  for (int t = 0; t < threads; ++t) {
+    workers[t].join();
+    if (t > 0) {
+      profiles[0]->merge(*profiles[t]);
+      delete profiles[t];
+    }
+  }
+  StackDistanceProfile &profile = *profiles[0];
+
+  int lineSize = cacheTable.get_line_size();
+  unsigned long accesses = profile.get_accesses();
+  cacheTable.print_configuration();
+  std::cout << "   Write-Back Miss Curve\n";
+  std::cout << "***************************\n";
+  std::cout << "References:\t" << accesses << "\n\n";
+  std::cout << std::setw(6) << std::left << "Ways"
+    << std::setw(12) << "Size (B)"
+    << std::setw(12) << "Misses"
+    << std::setw(12) << "Miss Rate"
+    << std::setw(12) << "Writebacks"
+    << std::setw(12) << "Traffic (B)";
+  std::cout << std::setfill('*') << std::setw(66) << "\n" << std::setfill(' ');
+  std::cout << "\n" << std::setprecision(5);
+  for (int ways = 1; ways <= maxWays; ++ways) {
+    unsigned long misses = profile.get_misses(ways);
+    unsigned long writebacks = profile.get_writebacks(ways);
+    std::cout << std::setw(6) << ways
+      << std::setw(12) << (unsigned long)numberOfSets * ways * lineSize
+      << std::setw(12) << misses
+      << std::setw(12) << (accesses ? (double)misses / accesses : 0.0)
+      << std::setw(12) << writebacks
+      << (misses + writebacks) * lineSize << "\n";
+  }
+  delete profiles[0];
+}
+
+class ReuseTimeModel
+{
+  /* predicts LRU miss ratios for every associativity from a histogram of
+  reuse times, the number of references to a set since the line was last
+  used there, with the average eviction time (AET) model. a line that is
+  not reused evicts once it has sat through AET(c) references, where AET(c)
+  is the time at which the lines still waiting for their reuse add up to
+  the c ways of the set, so the miss ratio of a c way cache is the share of
+  reuse times longer than AET(c). each reference costs one hash lookup,
+  and the histogram uses logarithmic bins past the first few */
+
+  public:
+
+    ReuseTimeModel(int numberOfSets, bool switchFlushes)
+      : numberOfSets_(numberOfSets), switchFlushes_(switchFlushes),
+      clock_(numberOfSets, 0), reuseTimes_(BINS, 0) {}
+
+    void run(std::vector<MemRef> &memRefs) {
+      for (std::vector<MemRef>::iterator it = memRefs.begin();
+          it != memRefs.end(); ++it) {
+        unsigned long line = it->getTag() * numberOfSets_ + it->getIndex();
+        if (it->getRW() == ReadOrWrite::FLUSH
+            || (it->getRW() == ReadOrWrite::SWITCH && switchFlushes_)) {
+          lastUse_.clear();
+          continue;
+        } else if (it->getRW() == ReadOrWrite::INVALIDATE) {
+          lastUse_.erase(line);
+          continue;
+        } else if (!it->is_access()) {
+          continue;
+        }
+
+        accesses_++;
+        unsigned long &now = clock_[it->getIndex()];
+        std::unordered_map<unsigned long, unsigned long>::iterator last =
+          lastUse_.find(line);
+        if (last == lastUse_.end()) {
+          coldMisses_++;
+          lastUse_[line] = now;
+        } else {
+          reuseTimes_[bin(now - last->second)]++;
+          last->second = now;
+        }
+        now++;
+      }
+    }
+
+    unsigned long get_accesses() {
+      return accesses_;
+    }
+
+    // the predicted miss ratio of a set with ways ways, and its eviction
+    // time in references to the set
+    double get_miss_ratio(int ways, double &evictionTime) {
+      if (accesses_ == 0) {
+        evictionTime = 0;
+        return 0;
+      }
+
+      // p is the share of reuse times longer than the time walked so far,
+      // and area the sum of p over that time
+      double p = 1;
+      double area = 0;
+      for (int b = 0; b < BINS; ++b) {
+        double start = bin_start(b);
+        double width = bin_start(b + 1) - start;
+        double share = (double)reuseTimes_[b] / accesses_;
+        if (b < EXACT_BINS) {
+          // every reuse time in an exact bin is b, so p steps down at b and
+          // is interpolated up to the next step
+          p -= share;
+          if (area + p >= ways) {
+            double t = (ways - area) / p;
+            double next = (double)reuseTimes_[b + 1] / accesses_
+              / (bin_start(b + 2) - bin_start(b + 1));
+            evictionTime = start + t;
+            return p - next * t;
+          }
+          area += p;
+          continue;
+        }
+
+        // the reuse times in a logarithmic bin are spread evenly over it,
+        // so p falls linearly, by slope per reference
+        double slope = share / width;
+        double binArea = width * p - slope * width * width / 2;
+        if (area + binArea >= ways) {
+          double need = ways - area;
+          double t = slope == 0 ? need / p
+            : (p - sqrt(std::max(0.0, p * p - 2 * slope * need))) / slope;
+          evictionTime = start + t;
+          return p - slope * t;
+        }
+        area += binArea;
+        p -= share;
+      }
+
+      // only lines that are never reused are left, and they keep the set
+      // full forever
+      evictionTime = INFINITY;
+      return (double)coldMisses_ / accesses_;
+    }
+
+  private:
+
+    // reuse times up to EXACT_BINS - 1 get a bin each, and every doubling
+    // after that is split into SUB_BINS bins
+    static const int
+      EXACT_BINS = 64,
+      SUB_BIN_BITS = 4,
+      SUB_BINS = 1 << SUB_BIN_BITS,
+      BINS = EXACT_BINS + (64 - 6) * SUB_BINS;
+
+    static int bin(unsigned long time) {
+      if (time < (unsigned long)EXACT_BINS) {
+        return time;
+      }
+      int octave = 63 - __builtin_clzl(time);
+      int sub = (time >> (octave - SUB_BIN_BITS)) & (SUB_BINS - 1);
+      return EXACT_BINS + (octave - 6) * SUB_BINS + sub;
+    }
+
+    // the smallest reuse time in bin b
+    static double bin_start(int b) {
+      if (b < EXACT_BINS) {
+        return b;
+      }
+      int octave = (b - EXACT_BINS) / SUB_BINS + 6;
+      int sub = (b - EXACT_BINS) % SUB_BINS;
+      return ldexp(SUB_BINS + sub, octave - SUB_BIN_BITS);
+    }
+
+    int
+      numberOfSets_;
+
+    // whether an address space switch flushes the cache
+    bool
+      switchFlushes_;
+
+    unsigned long
+      accesses_ = 0,
+      coldMisses_ = 0;
+
+    // references to each set so far
+    std::vector<unsigned long>
+      clock_;
+
+    // reuse time histogram, by bin()
+    std::vector<unsigned long>
+      reuseTimes_;
+
+    // the set clock at each line's last use
+    std::unordered_map<unsigned long, unsigned long>
+      lastUse_;
+
+}; // end class ReuseTimeModel
+
+
+// prints the AET model's misses for LRU caches with 1 to maxWays ways,
+// keeping the table's sets and line size
+void run_reuse_time_model(CacheTable &cacheTable, int maxWays) {
+  ReuseTimeModel model(cacheTable.get_number_of_sets(),
+      !cacheTable.is_translated());
+  model.run(cacheTable.get_mem_refs());
+
+  int lineSize = cacheTable.get_line_size();
+  unsigned long accesses = model.get_accesses();
+  cacheTable.print_configuration();
+  std::cout << "   AET Miss Ratio Curve\n";
+  std::cout << "**************************\n";
+  std::cout << "References:\t" << accesses << "\n\n";
+  std::cout << std::setw(6) << std::left << "Ways"
+    << std::setw(12) << "Size (B)"
+    << std::setw(12) << "Misses"
+    << std::setw(12) << "Miss Rate"
+    << std::setw(12) << "AET";
+  std::cout << std::setfill('*') << std::setw(54) << "\n" << std::setfill(' ');
+  std::cout << "\n" << std::setprecision(5);
+  for (int ways = 1; ways <= maxWays; ++ways) {
+    double evictionTime;
+    double missRatio = model.get_miss_ratio(ways, evictionTime);
+    std::cout << std::setw(6) << ways
+      << std::setw(12)
+      << (unsigned long)cacheTable.get_number_of_sets() * ways * lineSize
+      << std::setw(12) << (unsigned long)(missRatio * accesses + 0.5)
+      << std::setw(12) << missRatio
+      << std::setw(12) << evictionTime << "\n";
+  }
+}
+
+// compares the AET model with the exact LRU engine for 1 to maxWays ways,
+// on the table's own trace and on generated traces of refs references:
+// uniform picks lines at random, skewed favors a few of them, loop scans a
+// cache's worth of lines with some random references mixed in, and stream
+// splits its references between a small hot set and lines never reused
+void run_reuse_time_validation(CacheTable &cacheTable, int maxWays,
+    unsigned long refs, unsigned long seed) {
+  int numberOfSets = cacheTable.get_number_of_sets();
+  int lineSize = cacheTable.get_line_size();
+  // twice the lines of the largest cache
+  unsigned long footprint = 2UL * numberOfSets * maxWays;
+  const char *names[] = {"trace", "uniform", "skewed", "loop", "stream"};
+
+  cacheTable.print_configuration();
+  std::cout << "   AET Model Validation\n";
+  std::cout << "**************************\n";
+  std::cout << std::setw(10) << std::left << "Trace"
+    << std::setw(6) << "Ways"
+    << std::setw(12) << "Exact"
+    << std::setw(12) << "Model"
+    << std::setw(12) << "Error";
+  std::cout << std::setfill('*') << std::setw(52) << "\n" << std::setfill(' ');
+  std::cout << "\n" << std::setprecision(5);
+
+  double worst = 0;
+  unsigned long random = seed | 1;
+  for (int kind = 0; kind < 5; ++kind) {
+    CacheTable generated;
+    generated.configure(maxWays, lineSize, numberOfSets * maxWays * lineSize);
+    if (kind == 0) {
+      generated.adopt_mem_refs(cacheTable);
+    }
+    unsigned long next = footprint;
+    for (unsigned long r = 0; kind > 0 && r < refs; ++r) {
+      // xorshift64
+      random ^= random << 13;
+      random ^= random >> 7;
+      random ^= random << 17;
+      double u = (random >> 11) * 0x1.0p-53;
+      unsigned long line;
+      if (kind == 1) {
+        line = u * footprint;
+      } else if (kind == 2) {
+        line = u * u * u * footprint;
+      } else if (kind == 3) {
+        line = u < 0.1 ? (unsigned long)(u * 10 * footprint)
+          : r % (footprint / 2);
+      } else {
+        line = u < 0.5 ? (unsigned long)(u * 2 * footprint / 8) : next++;
+      }
+      generated.append_mem_ref(ReadOrWrite::READ, lineSize, line * lineSize,
+          0);
+    }
+
+    ReuseTimeModel model(numberOfSets, !generated.is_translated());
+    model.run(generated.get_mem_refs());
+    unsigned long accesses = model.get_accesses();
+    for (int ways = 1; ways <= maxWays && accesses > 0; ++ways) {
+      CacheTable exact;
+      exact.configure(ways, lineSize, numberOfSets * ways * lineSize);
+      exact.copy_options(cacheTable);
+      exact.adopt_mem_refs(generated);
+      exact.simulate_mem_refs();
+      double exactRatio = (double)exact.get_total_misses() / accesses;
+      double evictionTime;
+      double modelRatio = model.get_miss_ratio(ways, evictionTime);
+      worst = std::max(worst, fabs(modelRatio - exactRatio));
+      std::cout << std::setw(10) << names[kind]
+        << std::setw(6) << ways
+        << std::setw(12) << exactRatio
+        << std::setw(12) << modelRatio
+        << std::setw(12) << modelRatio - exactRatio << "\n";
+    }
+  }
+  std::cout << "\nLargest Error:\t" << worst << "\n";
+}
+
+// how TieredMemory decides to promote a slow tier page
+enum class TierPolicy {LRU, HOTNESS, SCAN};
+
+class TieredMemory
+{
+  /* a two tier main memory managed at page granularity, fed by the last
+  level cache's miss stream. pages are placed in the fast tier on first
+  touch while it has room, and later promoted by the policy: LRU promotes
+  on every slow access, HOTNESS once a page misses threshold times within
+  one window of scanInterval accesses, and SCAN mimics NUMA balancing: a
+  scanner marks scanPages pages every scanInterval accesses, and a page
+  whose hint faults come in consecutive scan passes is promoted. a full
+  fast tier demotes its least recently used page */
+
+  public:
 
-          if (it->check_cache_lines(tag)) {
-            // if tag matches cacheline then report hit
-            totalHits++;
-            return true;
-          } else {
-            // if no match
-            it->update_cache_lines(tag);
-            break;
-          }
-        } 
+    TieredMemory(unsigned long fastPages, TierPolicy policy,
+        unsigned long threshold, unsigned long scanInterval,
+        unsigned long scanPages)
+      : fastPages_(fastPages), policy_(policy), threshold_(threshold),
+      scanInterval_(std::max(scanInterval, 1UL)), scanPages_(scanPages) {}
+
+    void run(const std::vector<unsigned long> &pages) {
+      for (std::vector<unsigned long>::const_iterator it = pages.begin();
+          it != pages.end(); ++it) {
+        access(*it);
+      }
+    }
+
+    void access(unsigned long page) {
+      accesses_++;
+      if (policy_ == TierPolicy::SCAN && accesses_ % scanInterval_ == 0) {
+        scan();
+      }
+
+      std::unordered_map<unsigned long, PageState>::iterator it =
+        pages_.find(page);
+      if (it == pages_.end()) {
+        // first touch allocates in the fast tier while it has room
+        PageState &state = pages_[page];
+        scanOrder_.push_back(page);
+        if (fastList_.size() < fastPages_) {
+          fastAccesses_++;
+          state.fast = true;
+          fastList_.push_front(page);
+          state.position = fastList_.begin();
+        } else {
+          slowAccesses_++;
         }
-          // if no index match
-          // then MISS
-          totalMiss++;
-          return false;
+        return;
+      }
+
+      PageState &state = it->second;
+      if (state.fast) {
+        fastAccesses_++;
+        if (state.marked) {
+          state.marked = false;
+          hintFaults_++;
+        }
+        fastList_.splice(fastList_.begin(), fastList_, state.position);
+        return;
+      }
+
+      slowAccesses_++;
+      bool promote = false;
+      if (policy_ == TierPolicy::LRU) {
+        promote = true;
+      } else if (policy_ == TierPolicy::HOTNESS) {
+        // counts start over in every window
+        unsigned long window = accesses_ / scanInterval_;
+        if (state.window != window) {
+          state.window = window;
+          state.count = 0;
+        }
+        promote = ++state.count >= threshold_;
+      } else if (state.marked) {
+        state.marked = false;
+        hintFaults_++;
+        promote = state.lastFault != 0 && state.lastFault + 1 >= scanPass_;
+        state.lastFault = scanPass_;
+      }
+      if (promote && fastPages_ > 0) {
+        promote_page(page, state);
+      }
     }
 
-    // generates the cache sets according to info from config file
-    void create_cache_sets(int numberOfSets_) {
-      for (int i = 0; i < numberOfSets_; ++i) {
-        CacheSet *cacheSet = new CacheSet(setSize_);
-        cacheSet_.push_back(*cacheSet); 
+    // getters
+    unsigned long get_fast_pages() {
+      return fastPages_;
+    }
+
+    unsigned long get_fast_accesses() {
+      return fastAccesses_;
+    }
+
+    unsigned long get_slow_accesses() {
+      return slowAccesses_;
+    }
+
+    unsigned long get_promotions() {
+      return promotions_;
+    }
+
+    unsigned long get_demotions() {
+      return demotions_;
+    }
+
+    unsigned long get_hint_faults() {
+      return hintFaults_;
+    }
+
+    unsigned long get_pages_touched() {
+      return pages_.size();
+    }
+
+  private:
+
+    struct PageState {
+      bool
+        fast = false,
+        marked = false;
+
+      unsigned long
+        count = 0,
+        window = 0,
+        lastFault = 0;
+
+      // where the page sits in fastList_ while it is fast
+      std::list<unsigned long>::iterator
+        position;
+    };
+
+    void promote_page(unsigned long page, PageState &state) {
+      if (fastList_.size() >= fastPages_) {
+        PageState &victim = pages_[fastList_.back()];
+        victim.fast = false;
+        victim.count = 0;
+        fastList_.pop_back();
+        demotions_++;
       }
+      state.fast = true;
+      fastList_.push_front(page);
+      state.position = fastList_.begin();
+      promotions_++;
     }
 
-    // iterate through all of the cacheSets and set their index numbers
-    void set_index_for_cache_sets() {
-      int indexSetter = 0;
-      for (std::vector<CacheSet>::iterator it = cacheSet_.begin(); 
-          it != cacheSet_.end(); ++it) {
-        it->setIndex(indexSetter++);
+    // marks the next scanPages pages in first touch order, so that their
+    // next access takes a hint fault
+    void scan() {
+      for (unsigned long i = 0; i < scanPages_ && !scanOrder_.empty(); ++i) {
+        if (scanCursor_ == scanOrder_.size()) {
+          scanCursor_ = 0;
+          scanPass_++;
+        }
+        pages_[scanOrder_[scanCursor_++]].marked = true;
       }
     }
 
-    // setters
-    int set_total_cache_size(int totalCacheSize) {
-      totalCacheSize_ = totalCacheSize;
+    unsigned long
+      fastPages_;
+
+    TierPolicy
+      policy_;
+
+    unsigned long
+      threshold_,
+      scanInterval_,
+      scanPages_,
+      scanPass_ = 1,
+      accesses_ = 0,
+      fastAccesses_ = 0,
+      slowAccesses_ = 0,
+      promotions_ = 0,
+      demotions_ = 0,
+      hintFaults_ = 0;
+
+    size_t
+      scanCursor_ = 0;
+
+    std::unordered_map<unsigned long, PageState>
+      pages_;
+
+    // fast tier pages, most recently used first
+    std::list<unsigned long>
+      fastList_;
+
+    std::vector<unsigned long>
+      scanOrder_;
+
+}; // end class TieredMemory
+
+// replays the memory traffic of an already simulated table against a fast
+// tier of each capacity, spread over the given number of threads
+void run_tiered_memory(CacheTable &cacheTable,
+    const std::vector<unsigned long> &capacities, TierPolicy policy,
+    unsigned long threshold, unsigned long scanInterval,
+    unsigned long scanPages, unsigned long pageSize, int threads) {
+  std::vector<unsigned long> pages = cacheTable.get_memory_traffic();
+  unsigned long pageBits = log2(pageSize);
+  for (std::vector<unsigned long>::iterator it = pages.begin();
+      it != pages.end(); ++it) {
+    *it >>= pageBits;
+  }
+
+  std::vector<TieredMemory*> tiers;
+  for (size_t k = 0; k < capacities.size(); ++k) {
+    tiers.push_back(new TieredMemory(capacities[k], policy, threshold,
+          scanInterval, scanPages));
+  }
+
+  // each thread gets a contiguous group of capacities
+  int count = capacities.size();
+  threads = std::max(1, std::min(threads, count));
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; ++t) {
+    int first = (long)count * t / threads;
+    int last = (long)count * (t + 1) / threads;
+    workers.push_back(std::thread([&tiers, &pages, first, last]() {
+          for (int k = first; k < last; ++k) {
+            tiers[k]->run(pages);
+          }
+        }));
+  }
+  for (std::vector<std::thread>::iterator it = workers.begin();
+      it != workers.end(); ++it) {
+    it->join();
+  }
+
+  const char *policyNames[] = {"lru", "hotness", "scan"};
+  std::cout << "\n";
+  std::cout << "   Tiered Memory Summary\n";
+  std::cout << "**************************\n";
+  std::cout << "Policy:\t\t"         << policyNames[(int)policy] << "\n";
+  std::cout << "Page Size:\t"        << pageSize << "\n";
+  std::cout << "Memory Accesses:\t"  << pages.size() << "\n";
+  std::cout << "Pages Touched:\t"    << (tiers.empty() ? 0
+      : tiers.front()->get_pages_touched()) << "\n\n";
+
+  std::cout << std::setw(12) << std::left << "Fast Pages"
+    << std::setw(12) << "Fast"
+    << std::setw(12) << "Slow"
+    << std::setw(10) << "Fast %"
+    << std::setw(12) << "Promotions"
+    << std::setw(12) << "Demotions"
+    << std::setw(14) << "Migrated MB"
+    << std::setw(12) << "Hint Faults";
+  std::cout << std::setfill('*') << std::setw(97) << "\n" << std::setfill(' ');
+  std::cout << "\n";
+  for (size_t k = 0; k < tiers.size(); ++k) {
+    TieredMemory *tier = tiers[k];
+    unsigned long migrations = tier->get_promotions() + tier->get_demotions();
+    std::cout << std::setw(12) << tier->get_fast_pages()
+      << std::setw(12) << tier->get_fast_accesses()
+      << std::setw(12) << tier->get_slow_accesses()
+      << std::setw(10) << std::setprecision(4) << (pages.empty() ? 0
+          : 100.0 * tier->get_fast_accesses() / pages.size())
+      << std::setw(12) << tier->get_promotions()
+      << std::setw(12) << tier->get_demotions()
+      << std::setw(14) << (double)migrations * pageSize / (1 << 20)
+      << std::setw(12) << tier->get_hint_faults() << "\n";
+    delete tier;
+  }
+}
+
+// compares two tables that simulated the same references, reporting the
+// references whose outcome changed without printing either full report
+void run_diff(CacheTable &base, CacheTable &other, size_t shown,
+    unsigned long seed) {
+  std::vector<MemRef> &baseRefs = base.get_mem_refs();
+  std::vector<MemRef> &otherRefs = other.get_mem_refs();
+  unsigned long lineMask = ~(base.get_line_size() - 1UL);
+
+  // flips per line: misses that became hits and hits that became misses
+  std::unordered_map<unsigned long, std::pair<unsigned long, unsigned long> >
+    lines;
+  unsigned long accesses = 0;
+  unsigned long baseHits = 0;
+  unsigned long otherHits = 0;
+  unsigned long flips = 0;
+
+  // a uniform sample of the flipped references, kept by reservoir sampling
+  std::vector<size_t> sample;
+  unsigned long random = seed | 1;
+  for (size_t i = 0; i < baseRefs.size(); ++i) {
+    if (!baseRefs[i].is_access()) {
+      continue;
+    }
+    accesses++;
+    bool baseHit = baseRefs[i].getHM();
+    bool otherHit = otherRefs[i].getHM();
+    baseHits += baseHit;
+    otherHits += otherHit;
+    if (baseHit == otherHit) {
+      continue;
+    }
+    std::pair<unsigned long, unsigned long> &line =
+      lines[baseRefs[i].getAddress() & lineMask];
+    if (otherHit) {
+      line.first++;
+    } else {
+      line.second++;
+    }
+    flips++;
+    if (sample.size() < shown) {
+      sample.push_back(i);
+    } else {
+      // xorshift64
+      random ^= random << 13;
+      random ^= random >> 7;
+      random ^= random << 17;
+      if (random % flips < shown) {
+        sample[random % flips] = i;
+      }
     }
+  }
 
-    int set_line_size(int lineSize) {
-      lineSize_ = lineSize;
+  unsigned long missToHit = 0;
+  for (std::unordered_map<unsigned long, std::pair<unsigned long,
+      unsigned long> >::iterator it = lines.begin(); it != lines.end(); ++it) {
+    missToHit += it->second.first;
+  }
+
+  std::cout << "\nBase:";
+  base.print_configuration();
+  std::cout << "Other:";
+  other.print_configuration();
+  std::cout << "       Diff Summary\n";
+  std::cout << "**************************\n";
+  std::cout << "References:\t"     << accesses << "\n";
+  std::cout << std::setprecision(5);
+  std::cout << "Base Hit Rate:\t"  << (accesses == 0 ? 0
+      : (double)baseHits / accesses) << "\n";
+  std::cout << "Other Hit Rate:\t" << (accesses == 0 ? 0
+      : (double)otherHits / accesses) << "\n";
+  std::cout << "Miss To Hit:\t"    << missToHit << "\n";
+  std::cout << "Hit To Miss:\t"    << flips - missToHit << "\n";
+  std::cout << "Lines Changed:\t"  << lines.size() << "\n\n";
+
+  // the lines with the most flips either way
+  std::vector<std::pair<unsigned long, std::pair<unsigned long,
+    unsigned long> > > ranked(lines.begin(), lines.end());
+  std::sort(ranked.begin(), ranked.end(),
+      [](const std::pair<unsigned long, std::pair<unsigned long,
+        unsigned long> > &a, const std::pair<unsigned long,
+        std::pair<unsigned long, unsigned long> > &b) {
+        unsigned long flipsA = a.second.first + a.second.second;
+        unsigned long flipsB = b.second.first + b.second.second;
+        return flipsA > flipsB || (flipsA == flipsB && a.first < b.first);
+      });
+  std::cout << std::setw(20) << std::left << "Line Address"
+    << std::setw(14) << "Miss To Hit"
+    << std::setw(14) << "Hit To Miss";
+  std::cout << std::setfill('*') << std::setw(49) << "\n" << std::setfill(' ');
+  std::cout << "\n";
+  for (size_t i = 0; i < ranked.size() && i < shown; ++i) {
+    std::cout << "0x" << std::setw(18) << std::hex << ranked[i].first
+      << std::dec << std::setw(14) << ranked[i].second.first
+      << std::setw(14) << ranked[i].second.second << "\n";
+  }
+
+  std::sort(sample.begin(), sample.end());
+  std::cout << "\n";
+  std::cout << std::setw(10) << "RefNum"
+    << std::setw(8)  << "R/W"
+    << std::setw(20) << "Address"
+    << std::setw(14) << "Change";
+  std::cout << std::setfill('*') << std::setw(53) << "\n" << std::setfill(' ');
+  std::cout << "\n";
+  for (std::vector<size_t>::iterator it = sample.begin(); it != sample.end();
+      ++it) {
+    MemRef &memRef = baseRefs[*it];
+    std::cout << std::setw(10) << memRef.getRefNum()
+      << std::setw(8) << (memRef.getRW() == ReadOrWrite::WRITE ? "Write"
+          : "Read")
+      << "0x" << std::setw(18) << std::hex << memRef.getAddress() << std::dec
+      << std::setw(14) << (otherRefs[*it].getHM() ? "Miss To Hit"
+          : "Hit To Miss") << "\n";
+  }
+}
+
+class AllocationLog
+{
+  /* attributes references to the program objects they touch. the log
+  holds one event per line:
+     alloc:<time>:<site>:<hexaddress>:<size>
+     free:<time>:<hexaddress>
+     stack:<hexlow>:<hexhigh>
+     global:<hexlow>:<hexhigh>
+  where time is the number of the first trace record the event applies to
+  and site names the call site that allocated. allocations are heap
+  objects, and the stack and global lines declare fixed address ranges.
+  live allocations are kept in a map from start address to object, which
+  is updated as the trace is replayed, so each reference finds its object
+  with one lookup */
+
+  public:
+
+    // returns 1 if the log cannot be read
+    int load(char* filename) {
+      std::ifstream is(filename);
+      if (is.fail()) {
+        std::cerr << "\nError opening file: \"" << filename
+          << "\"\n" << std::endl;
+        return 1;
+      }
+      std::string input;
+      boost::char_separator<char> delimeter(":");
+      while (std::getline(is, input)) {
+        Tokens tokens(input, delimeter);
+        std::vector<std::string> fields(tokens.begin(), tokens.end());
+        if (fields.empty()) {
+          continue;
+        }
+        Event event;
+        if (fields[0] == "alloc" && fields.size() >= 5) {
+          event.time = strtoul(fields[1].c_str(), NULL, 0);
+          event.site = fields[2];
+          event.address = strtoul(fields[3].c_str(), NULL, 16);
+          event.size = strtoul(fields[4].c_str(), NULL, 0);
+          event.alloc = true;
+          events_.push_back(event);
+        } else if (fields[0] == "free" && fields.size() >= 3) {
+          event.time = strtoul(fields[1].c_str(), NULL, 0);
+          event.address = strtoul(fields[2].c_str(), NULL, 16);
+          event.alloc = false;
+          events_.push_back(event);
+        } else if ((fields[0] == "stack" || fields[0] == "global")
+            && fields.size() >= 3) {
+          Range range = {strtoul(fields[1].c_str(), NULL, 16),
+            strtoul(fields[2].c_str(), NULL, 16)};
+          (fields[0] == "stack" ? stackRanges_ : globalRanges_).push_back(range);
+        } else {
+          std::cerr << "\nError in allocation log: \"" << input << "\"\n"
+            << std::endl;
+          return 1;
+        }
+      }
+      // events logged at the same time keep their order
+      std::stable_sort(events_.begin(), events_.end(),
+          [](const Event &a, const Event &b) { return a.time < b.time; });
+      return 0;
     }
 
-    int set_set_size(int setSize) {
-      setSize_ = setSize;
+    // replays the simulated references against the log
+    void attribute(std::vector<MemRef> &memRefs) {
+      std::vector<Event>::iterator event = events_.begin();
+      for (std::vector<MemRef>::iterator it = memRefs.begin();
+          it != memRefs.end(); ++it) {
+        while (event != events_.end()
+            && event->time <= (unsigned long)it->getRefNum()) {
+          apply(*event++);
+        }
+        if (!it->is_access()) {
+          continue;
+        }
+
+        Counts *counts = NULL;
+        unsigned long address = it->getAddress();
+        std::map<unsigned long, Object>::iterator object =
+          liveObjects_.upper_bound(address);
+        if (object != liveObjects_.begin()
+            && address < (--object)->first + object->second.size) {
+          counts = &sites_[object->second.site];
+          regions_[HEAP].accesses++;
+          if (!it->getHM()) {
+            regions_[HEAP].misses++;
+          }
+        } else {
+          Region region = OTHER;
+          if (in_ranges(stackRanges_, address)) {
+            region = STACK;
+          } else if (in_ranges(globalRanges_, address)) {
+            region = GLOBAL;
+          }
+          counts = &regions_[region];
+        }
+        counts->accesses++;
+        if (!it->getHM()) {
+          counts->misses++;
+        }
+      }
+      while (event != events_.end()) {
+        apply(*event++);
+      }
     }
 
-    // getters
-    int get_total_cache_size() {
-      return totalCacheSize_;
+    void print_summary(size_t shown) {
+      std::cout << "\n";
+      std::cout << "    Allocation Summary\n";
+      std::cout << "**************************\n";
+      std::cout << "Allocations:\t"   << allocations_ << "\n";
+      std::cout << "Frees:\t\t"       << frees_ << "\n";
+      if (unmatchedFrees_ > 0) {
+        std::cout << "Unmatched Frees:\t" << unmatchedFrees_ << "\n";
+      }
+      std::cout << "Live At End:\t"   << liveObjects_.size() << "\n\n";
+
+      // the sites with the most misses
+      std::vector<std::pair<std::string, Counts> > sites(sites_.begin(),
+          sites_.end());
+      std::sort(sites.begin(), sites.end(),
+          [](const std::pair<std::string, Counts> &a,
+            const std::pair<std::string, Counts> &b) {
+            return a.second.misses > b.second.misses
+              || (a.second.misses == b.second.misses && a.first < b.first);
+          });
+      std::cout << std::setw(24) << std::left << "Site";
+      print_header();
+      for (size_t i = 0; i < sites.size() && i < shown; ++i) {
+        std::cout << std::setw(24) << sites[i].first;
+        print_counts(sites[i].second);
+      }
+
+      const char *regionNames[] = {"stack", "heap", "global", "other"};
+      std::cout << "\n";
+      std::cout << std::setw(24) << "Region";
+      print_header();
+      for (int r = STACK; r <= OTHER; ++r) {
+        std::cout << std::setw(24) << regionNames[r];
+        print_counts(regions_[r]);
+      }
     }
 
-    int get_line_size() {
-      return lineSize_;
+  private:
+
+    enum Region {STACK, HEAP, GLOBAL, OTHER};
+
+    struct Event {
+      unsigned long
+        time = 0,
+        address = 0,
+        size = 0;
+
+      std::string
+        site;
+
+      bool
+        alloc = false;
+    };
+
+    struct Object {
+      unsigned long
+        size;
+
+      std::string
+        site;
+    };
+
+    struct Range {
+      unsigned long
+        low,
+        high;
+    };
+
+    struct Counts {
+      unsigned long
+        accesses = 0,
+        misses = 0;
+    };
+
+    void apply(const Event &event) {
+      if (event.alloc) {
+        Object object = {event.size, event.site};
+        liveObjects_[event.address] = object;
+        allocations_++;
+      } else if (liveObjects_.erase(event.address) > 0) {
+        frees_++;
+      } else {
+        unmatchedFrees_++;
+      }
     }
 
-    int get_set_size() {
-      return setSize_;
+    static bool in_ranges(const std::vector<Range> &ranges,
+        unsigned long address) {
+      for (std::vector<Range>::const_iterator it = ranges.begin();
+          it != ranges.end(); ++it) {
+        if (address >= it->low && address < it->high) {
+          return true;
+        }
+      }
+      return false;
     }
 
-    int get_number_of_sets() {
-      return numberOfSets_;
+    void print_header() {
+      std::cout << std::setw(12) << "Accesses"
+        << std::setw(12) << "Misses"
+        << std::setw(12) << "Miss Rate";
+      std::cout << std::setfill('*') << std::setw(61) << "\n" << std::setfill(' ');
+      std::cout << "\n";
     }
 
-  private:
+    void print_counts(const Counts &counts) {
+      std::cout << std::setw(12) << counts.accesses
+        << std::setw(12) << counts.misses
+        << std::setw(12) << std::setprecision(5) << (counts.accesses == 0 ? 0
+            : (double)counts.misses / counts.accesses) << "\n";
+    }
 
-    std::vector<CacheSet> 
-      cacheSet_;
+    std::vector<Event>
+      events_;
 
-    std::vector<MemRef> 
-      memRef_;
+    std::vector<Range>
+      stackRanges_,
+      globalRanges_;
 
-    int 
-      totalCacheSize_,
-      lineSize_,
-      setSize_,
-      numberOfSets_,
-      indexSize_,
-      tagSize_,
-      offsetSize_,
-      totalHits,
-      totalMiss,
-      totalAccess;
+    // live allocations by start address
+    std::map<unsigned long, Object>
+      liveObjects_;
 
-    unsigned long 
-      offsetMask_,
-      indexMask_,
-      tagMask_;
+    std::map<std::string, Counts>
+      sites_;
 
-    double
-      hitRate,
-      missRate;
+    Counts
+      regions_[OTHER + 1];
 
-}; // end class CacheTable
+    unsigned long
+      allocations_ = 0,
+      frees_ = 0,
+      unmatchedFrees_ = 0;
+
+}; // end class AllocationLog
 
 int main(int argc, char* argv[]) {
 
-  if (argc != 2) {
+  if (argc >= 3) {
 // create and config a cache table
     CacheTable *cacheTable = new CacheTable;
 
-    cacheTable->read_cache_config(argv[1]);
-    cacheTable->calculate_number_of_sets();
-    cacheTable->create_cache_sets(cacheTable->get_number_of_sets());
-    cacheTable->set_index_for_cache_sets();
-    cacheTable->calculate_index_size();
-    cacheTable->calculate_offset_size();
-    cacheTable->calculate_tag_size();
-    cacheTable->calculate_offset_mask();
-    cacheTable->calculate_index_mask();
-    cacheTable->calculate_tag_mask();
+    // producer threads for the concurrent stress benchmark, if requested
+    int stressThreads = 0;
+
+    // references per thread for the trace emitter benchmark, if requested
+    unsigned long emitRefs = 0;
+
+    // random replacement replicas and the seed of the first one
+    int randomReplicas = 0;
+    unsigned long randomSeed = 1;
+    int threads = 1;
+
+    // largest associativity of the write-back miss curve, if requested
+    int curveWays = 0;
+
+    // largest associativity of the AET model's curve, and the length of
+    // the generated traces that validate it
+    int aetWays = 0;
+    unsigned long aetCheckRefs = 0;
+
+    // virtual to physical translation, off unless -paging is given
+    bool paging = false;
+    PageAllocation pageAllocation = PageAllocation::SEQUENTIAL;
+    unsigned long pageSize = 4096;
+    unsigned long physicalMemory = 1UL << 32;
+    bool hugePages = false;
+    bool pageSizeGiven = false;
+
+    // cores with private caches and the size of their directory
+    int cores = 1;
+    int directoryEntries = 0;
+    int directorySetSize = 0;
+
+    // sockets the cores are spread over and their shared caches
+    int sockets = 1;
+    char *llcConfig = NULL;
+    HomePolicy homePolicy = HomePolicy::FIRST_TOUCH;
+    unsigned long regionSize = 1UL << 20;
+
+    // fast tier capacities in pages, and how pages get promoted
+    std::vector<unsigned long> tierCapacities;
+    TierPolicy tierPolicy = TierPolicy::HOTNESS;
+    unsigned long tierThreshold = 2;
+    unsigned long tierScanInterval = 1000;
+    unsigned long tierScanPages = 256;
+
+    // conflict edges shown and the sketch capacity behind them
+    size_t conflictsShown = 0;
+    unsigned long conflictRegion = 4096;
+
+    // allocation log to attribute references to program objects
+    char *allocationLog = NULL;
+
+    // block table that B records of an instruction trace refer to
+    char *blockTable = NULL;
+
+    // write-combining buffer entries per core, none unless -wcb is given
+    size_t writeCombining = 0;
+
+    // whether to keep the decoded trace in shared memory for later runs
+    bool sharedTrace = false;
+
+    // a second configuration to compare against, and its insertion policy
+    char *diffConfig = NULL;
+    std::string diffInsert;
+
+    // file for the per-reference results in Arrow IPC format
+    char *arrowResults = NULL;
+
+    // seconds between reports while following a growing trace
+    double followInterval = 0;
+
+    // replacement policy plugin and the string passed to it
+    char *plugin = NULL;
+    char *pluginArgs = NULL;
+
+    // optional flags follow the two file names
+    std::vector<std::string> optionsGiven;
+    for (int i = 3; i < argc; ++i) {
+      std::string option = argv[i];
+      optionsGiven.push_back(option);
+      if (option == "-threads" && i + 1 < argc) {
+        threads = atoi(argv[++i]);
+        cacheTable->set_engine(SimEngine::PARALLEL);
+        cacheTable->set_threads(threads);
+      } else if (option == "-fastforward") {
+        cacheTable->set_engine(SimEngine::FAST_FORWARD);
+      } else if (option == "-engine" && i + 1 < argc) {
+        std::string engine = argv[++i];
+        if (engine == "serial") {
+          cacheTable->set_engine(SimEngine::SERIAL);
+        } else if (engine == "parallel") {
+          cacheTable->set_engine(SimEngine::PARALLEL);
+        } else if (engine == "fastforward") {
+          cacheTable->set_engine(SimEngine::FAST_FORWARD);
+        } else if (engine == "auto") {
+          cacheTable->set_auto_engine();
+        } else {
+          std::cerr << "\nUnknown engine: \"" << engine << "\"\n" << std::endl;
+          delete cacheTable;
+          return 1;
+        }
+      } else if (option == "-loopperiod" && i + 1 < argc) {
+        cacheTable->set_loop_max_period(atol(argv[++i]));
+      } else if (option == "-level" && i + 1 < argc) {
+        CacheTable *level = new CacheTable;
+        if (level->configure(argv[++i]) != 0) {
+          delete level;
+          delete cacheTable;
+          return 1;
+        }
+        cacheTable->add_lower_level(level);
+      } else if (option == "-inclusive") {
+        cacheTable->set_inclusive(true);
+      } else if (option == "-stress" && i + 1 < argc) {
+        stressThreads = atoi(argv[++i]);
+      } else if (option == "-insert" && i + 1 < argc) {
+        std::string policy = argv[++i];
+        if (policy == "lip") {
+          cacheTable->set_insertion_policy(InsertionPolicy::LIP);
+        } else if (policy == "bip") {
+          cacheTable->set_insertion_policy(InsertionPolicy::BIP);
+        } else if (policy == "dip") {
+          cacheTable->set_insertion_policy(InsertionPolicy::DIP);
+        } else if (policy != "mru") {
+          std::cerr << "\nUnknown insertion policy: \"" << policy << "\"\n"
+            << std::endl;
+          delete cacheTable;
+          return 1;
+        }
+      } else if (option == "-paging" && i + 1 < argc) {
+        std::string policy = argv[++i];
+        paging = true;
+        if (policy == "random") {
+          pageAllocation = PageAllocation::RANDOM;
+        } else if (policy == "sequential") {
+          pageAllocation = PageAllocation::SEQUENTIAL;
+        } else if (policy == "color") {
+          pageAllocation = PageAllocation::COLORING;
+        } else if (policy == "huge") {
+          pageAllocation = PageAllocation::SEQUENTIAL;
+          pageSize = 1UL << 21;
+          hugePages = true;
+        } else {
+          std::cerr << "\nUnknown page allocation: \"" << policy << "\"\n"
+            << std::endl;
+          delete cacheTable;
+          return 1;
+        }
+      } else if (option == "-pagesize" && i + 1 < argc) {
+        pageSize = strtoul(argv[++i], NULL, 0);
+        pageSizeGiven = true;
+      } else if (option == "-physmem" && i + 1 < argc) {
+        physicalMemory = strtoul(argv[++i], NULL, 0) << 20;
+      } else if (option == "-cores" && i + 1 < argc) {
+        cores = atoi(argv[++i]);
+      } else if (option == "-directory" && i + 2 < argc) {
+        directoryEntries = atoi(argv[++i]);
+        directorySetSize = atoi(argv[++i]);
+      } else if (option == "-sockets" && i + 1 < argc) {
+        sockets = atoi(argv[++i]);
+      } else if (option == "-llc" && i + 1 < argc) {
+        llcConfig = argv[++i];
+      } else if (option == "-numa" && i + 1 < argc) {
+        std::string policy = argv[++i];
+        if (policy == "interleave") {
+          homePolicy = HomePolicy::INTERLEAVE;
+        } else if (policy == "firsttouch") {
+          homePolicy = HomePolicy::FIRST_TOUCH;
+        } else {
+          std::cerr << "\nUnknown home policy: \"" << policy << "\"\n"
+            << std::endl;
+          delete cacheTable;
+          return 1;
+        }
+      } else if (option == "-region" && i + 1 < argc) {
+        regionSize = strtoul(argv[++i], NULL, 0);
+      } else if (option == "-follow" && i + 1 < argc) {
+        followInterval = atof(argv[++i]);
+      } else if (option == "-arrow" && i + 1 < argc) {
+        arrowResults = argv[++i];
+      } else if (option == "-plugin" && i + 1 < argc) {
+        plugin = argv[++i];
+      } else if (option == "-pluginargs" && i + 1 < argc) {
+        pluginArgs = argv[++i];
+      } else if (option == "-diff" && i + 1 < argc) {
+        diffConfig = argv[++i];
+      } else if (option == "-diffinsert" && i + 1 < argc) {
+        diffInsert = argv[++i];
+      } else if (option == "-allocs" && i + 1 < argc) {
+        allocationLog = argv[++i];
+      } else if (option == "-bbtable" && i + 1 < argc) {
+        blockTable = argv[++i];
+      } else if (option == "-wcb" && i + 1 < argc) {
+        writeCombining = strtoul(argv[++i], NULL, 0);
+      } else if (option == "-shm") {
+        sharedTrace = true;
+      } else if (option == "-conflicts" && i + 1 < argc) {
+        conflictsShown = strtoul(argv[++i], NULL, 0);
+      } else if (option == "-conflictregion" && i + 1 < argc) {
+        conflictRegion = strtoul(argv[++i], NULL, 0);
+      } else if (option == "-tier" && i + 1 < argc) {
+        // a comma separated list of capacities
+        std::string list = argv[++i];
+        boost::char_separator<char> comma(",");
+        Tokens capacities(list, comma);
+        for (Tokens::iterator it = capacities.begin(); it != capacities.end();
+            ++it) {
+          tierCapacities.push_back(strtoul(it->c_str(), NULL, 0));
+        }
+      } else if (option == "-tierpolicy" && i + 1 < argc) {
+        std::string policy = argv[++i];
+        if (policy == "lru") {
+          tierPolicy = TierPolicy::LRU;
+        } else if (policy == "hotness") {
+          tierPolicy = TierPolicy::HOTNESS;
+        } else if (policy == "scan") {
+          tierPolicy = TierPolicy::SCAN;
+        } else {
+          std::cerr << "\nUnknown tier policy: \"" << policy << "\"\n"
+            << std::endl;
+          delete cacheTable;
+          return 1;
+        }
+      } else if (option == "-tierthreshold" && i + 1 < argc) {
+        tierThreshold = strtoul(argv[++i], NULL, 0);
+      } else if (option == "-tierscan" && i + 2 < argc) {
+        tierScanInterval = strtoul(argv[++i], NULL, 0);
+        tierScanPages = strtoul(argv[++i], NULL, 0);
+      } else if (option == "-random" && i + 1 < argc) {
+        randomReplicas = atoi(argv[++i]);
+      } else if (option == "-mrc" && i + 1 < argc) {
+        curveWays = atoi(argv[++i]);
+      } else if (option == "-aet" && i + 1 < argc) {
+        aetWays = atoi(argv[++i]);
+      } else if (option == "-aetcheck" && i + 1 < argc) {
+        aetCheckRefs = strtoul(argv[++i], NULL, 0);
+      } else if (option == "-emitbench" && i + 1 < argc) {
+        emitRefs = strtoul(argv[++i], NULL, 0);
+      } else if (option == "-seed" && i + 1 < argc) {
+        randomSeed = strtoul(argv[++i], NULL, 10);
+      } else {
+        std::cerr << "\nUnknown option: \"" << option << "\"\n" << std::endl;
+        delete cacheTable;
+        return 1;
+      }
+    }
+
+    if (sharedTrace && paging) {
+      // the page table is built while decoding, and is not shared
+      std::cerr << "\nError: -shm cannot be combined with -paging\n"
+        << std::endl;
+      delete cacheTable;
+      return 1;
+    }
+
+    if (allocationLog != NULL && paging) {
+      // the log holds virtual addresses, but the references would be physical
+      std::cerr << "\nError: -allocs cannot be combined with -paging\n"
+        << std::endl;
+      delete cacheTable;
+      return 1;
+    }
+
+    if (hugePages && pageSizeGiven) {
+      // huge pages are 2MB, so a page size given as well would be ignored
+      std::cerr << "\nError: -paging huge cannot be combined with -pagesize\n"
+        << std::endl;
+      delete cacheTable;
+      return 1;
+    }
+
+    if (pageSize == 0 || (pageSize & (pageSize - 1)) != 0) {
+      std::cerr << "\nError: -pagesize must be a power of two\n" << std::endl;
+      delete cacheTable;
+      return 1;
+    }
+
+    if (cacheTable->is_auto_engine() && (aetCheckRefs > 0 || cores > 1
+          || followInterval > 0)) {
+      // these modes do not run the decoded trace on the table's engine
+      std::cerr << "\nError: -engine auto cannot be combined with -aetcheck, "
+        << "-cores or -follow\n" << std::endl;
+      delete cacheTable;
+      return 1;
+    }
+
+    if (cores > 1) {
+      // the private caches are LRU copies of the configured cache, run
+      // serially, and the other modes do not model cores, so these would
+      // be ignored
+      const char *unsupported[] = {"-threads", "-fastforward", "-engine",
+        "-loopperiod", "-level", "-inclusive", "-insert", "-plugin",
+        "-conflicts", "-arrow", "-allocs", "-diff", "-follow", "-stress",
+        "-random", "-mrc", "-aet", "-aetcheck", "-emitbench", "-tier"};
+      for (size_t k = 0; k < sizeof(unsupported) / sizeof(*unsupported); ++k) {
+        if (std::find(optionsGiven.begin(), optionsGiven.end(),
+              unsupported[k]) != optionsGiven.end()) {
+          std::cerr << "\nError: -cores cannot be combined with "
+            << unsupported[k] << "\n" << std::endl;
+          delete cacheTable;
+          return 1;
+        }
+      }
+    }
+
+    if (!tierCapacities.empty() && (emitRefs > 0 || stressThreads > 0
+          || randomReplicas > 0 || curveWays > 0 || aetWays > 0
+          || aetCheckRefs > 0 || cores > 1 || diffConfig != NULL
+          || followInterval > 0)) {
+      // only the plain simulation records the traffic the tiers replay
+      std::cerr << "\nError: -tier cannot be combined with -emitbench, "
+        << "-stress, -random, -mrc, -aet, -aetcheck, -cores, -diff or "
+        << "-follow\n" << std::endl;
+      delete cacheTable;
+      return 1;
+    }
+
+    if (paging && physicalMemory < pageSize) {
+      std::cerr << "\nError: -physmem must hold at least one page\n"
+        << std::endl;
+      delete cacheTable;
+      return 1;
+    }
+
+    cacheTable->configure(argv[1]);
+
+    if (blockTable != NULL && cacheTable->read_block_table(blockTable) != 0) {
+      delete cacheTable;
+      return 1;
+    }
+    cacheTable->set_write_combining(writeCombining);
+    if (sharedTrace) {
+      cacheTable->set_shared_trace();
+    }
+
+    if (plugin != NULL && cacheTable->load_plugin(plugin, pluginArgs) != 0) {
+      delete cacheTable;
+      return 1;
+    }
+
+    if (conflictsShown > 0) {
+      // the sketch keeps more edges than it shows, so the top ones are
+      // accurate
+      cacheTable->set_conflict_graph(conflictsShown * 16, conflictRegion,
+          conflictsShown);
+    }
+
+    if (paging) {
+      // a page color is one page's worth of consecutive sets
+      unsigned long setSpan = (unsigned long)cacheTable->get_number_of_sets()
+        * cacheTable->get_line_size();
+      cacheTable->set_page_table(new PageTable(pageAllocation, pageSize,
+            physicalMemory / pageSize, setSpan / pageSize, randomSeed));
+    }
+
+    if (emitRefs > 0) {
+      // the trace comes from the benchmark, so the trace argument is unused
+      run_emitter_benchmark(*cacheTable, emitRefs, threads);
+      delete cacheTable;
+      return 0;
+    }
+
+    if (stressThreads > 0) {
+      // benchmark the concurrent table instead of simulating
+      if (cacheTable->decode_mem_trace(argv[2]) == 0) {
+        run_stress_benchmark(*cacheTable, stressThreads);
+      }
+      delete cacheTable;
+      return 0;
+    }
+
+    if (randomReplicas > 0) {
+      // the replicas replace the LRU simulation
+      if (cacheTable->decode_mem_trace(argv[2]) == 0) {
+        run_random_replacement(*cacheTable, randomReplicas, randomSeed,
+            threads);
+      }
+      delete cacheTable;
+      return 0;
+    }
+
+    if (curveWays > 0) {
+      // one pass covers every associativity up to curveWays
+      if (cacheTable->decode_mem_trace(argv[2]) == 0) {
+        run_stack_distance_profile(*cacheTable, curveWays, threads);
+      }
+      delete cacheTable;
+      return 0;
+    }
+
+    if (aetWays > 0 || aetCheckRefs > 0) {
+      // the model's curve, or its comparison with the exact engine up to
+      // the configured associativity unless -aet gives another
+      if (cacheTable->decode_mem_trace(argv[2]) == 0) {
+        if (aetCheckRefs > 0) {
+          run_reuse_time_validation(*cacheTable,
+              aetWays > 0 ? aetWays : cacheTable->get_set_size(),
+              aetCheckRefs, randomSeed);
+        } else {
+          run_reuse_time_model(*cacheTable, aetWays);
+        }
+      }
+      delete cacheTable;
+      return 0;
+    }
+
+    if (cores > 1) {
+      // every core gets a private copy of the configured cache
+      MultiCoreSystem multiCore(cores, sockets);
+      multiCore.set_numa(homePolicy, pageSize, regionSize);
+      if (multiCore.configure(argv[1], directoryEntries, directorySetSize) != 0
+          || (llcConfig != NULL && multiCore.configure_llc(llcConfig) != 0)
+          || cacheTable->decode_mem_trace(argv[2]) != 0) {
+        delete cacheTable;
+        return 1;
+      }
+      multiCore.simulate(*cacheTable);
+      cacheTable->count_results();
+      cacheTable->print_summary();
+      multiCore.print_summary();
+      if (sockets > 1 || llcConfig != NULL) {
+        multiCore.print_numa_summary();
+      }
+      delete cacheTable;
+      return 0;
+    }
+
+    if (diffConfig != NULL) {
+      // both tables simulate the references decoded once, side by side
+      CacheTable *diffTable = new CacheTable;
+      diffTable->copy_options(*cacheTable);
+      if (diffInsert == "lip") {
+        diffTable->set_insertion_policy(InsertionPolicy::LIP);
+      } else if (diffInsert == "bip") {
+        diffTable->set_insertion_policy(InsertionPolicy::BIP);
+      } else if (diffInsert == "dip") {
+        diffTable->set_insertion_policy(InsertionPolicy::DIP);
+      } else if (diffInsert == "mru") {
+        diffTable->set_insertion_policy(InsertionPolicy::MRU);
+      } else if (!diffInsert.empty()) {
+        std::cerr << "\nUnknown insertion policy: \"" << diffInsert << "\"\n"
+          << std::endl;
+        delete diffTable;
+        delete cacheTable;
+        return 1;
+      }
+      if (diffTable->configure(diffConfig) == 0
+          && cacheTable->decode_mem_trace(argv[2]) == 0) {
+        diffTable->adopt_mem_refs(*cacheTable);
+        if (cacheTable->is_auto_engine()) {
+          // each configuration gets its own engine
+          cacheTable->select_engine();
+          diffTable->select_engine();
+        }
+        std::thread other(&CacheTable::simulate_mem_refs, diffTable);
+        cacheTable->simulate_mem_refs();
+        other.join();
+        run_diff(*cacheTable, *diffTable, 20, randomSeed);
+      }
+      delete diffTable;
+      delete cacheTable;
+      return 0;
+    }
+
+    if (followInterval > 0) {
+      // references are dropped once simulated, so only the totals remain
+      if (!cacheTable->can_follow()) {
+        std::cerr << "\nError: -follow cannot be combined with -level or "
+          << "-plugin\n" << std::endl;
+        delete cacheTable;
+        return 1;
+      }
+      if (cacheTable->follow_mem_trace(argv[2], followInterval) != 0) {
+        delete cacheTable;
+        return 1;
+      }
+      cacheTable->print_summary(false);
+      delete cacheTable;
+      return 0;
+    }
 
     // parse memory trace and print summary
-    cacheTable->read_mem_trace(argv[2]);
-    cacheTable->print_summary();
+    if (!tierCapacities.empty()) {
+      cacheTable->record_memory_traffic();
+    }
+    if (cacheTable->read_mem_trace(argv[2]) != 0) {
+      delete cacheTable;
+      return 1;
+    }
+    if (arrowResults != NULL) {
+      // the results go to the file instead of the per-reference report
+      if (cacheTable->write_arrow_results(arrowResults) != 0) {
+        std::cerr << "\nError writing file: \"" << arrowResults << "\"\n"
+          << std::endl;
+        delete cacheTable;
+        return 1;
+      }
+      cacheTable->print_summary(false);
+    } else {
+      cacheTable->print_summary();
+    }
+
+    if (allocationLog != NULL) {
+      AllocationLog allocations;
+      if (allocations.load(allocationLog) == 0) {
+        allocations.attribute(cacheTable->get_mem_refs());
+        allocations.print_summary(20);
+      }
+    }
+
+    if (!tierCapacities.empty()) {
+      run_tiered_memory(*cacheTable, tierCapacities, tierPolicy,
+          tierThreshold, tierScanInterval, tierScanPages, pageSize, threads);
+    }
 
     delete cacheTable;
   } else {
     // error if bad syntax
-    std::cout << "\nSyntax: cacheSim <cacheConfig> <memTrace>"
+    std::cout << "\nSyntax: cacheSim <cacheConfig> <memTrace> [options]"
       << std::endl;
   }
 
   return 0;
 }
-
@@ -0,0 +1,88 @@
+/* replacement policy plugins for cacheSim
+
+   a plugin is a shared library exporting cachesim_get_policy(), which returns
+   the policy's function table. it is loaded with
+
+     cacheSim <cacheConfig> <memTrace> -plugin ./policy.so [-pluginargs str]
+
+   the simulator keeps the tags and a zeroed metadata buffer for every
+   set, and tells the policy what happened to each way in batches of
+   events, in trace order. only a miss in a full set needs an answer right
+   away: every earlier event is delivered first, then victim() picks the
+   way to evict. nothing is called per hit.
+
+   the header is plain C so plugins can be built with any compiler:
+
+     cc -shared -fPIC -o policy.so policy.c
+*/
+
+#ifndef CACHESIM_PLUGIN_H
+#define CACHESIM_PLUGIN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CACHESIM_PLUGIN_ABI_VERSION 1
+
+/* what happened to a way */
+enum cachesim_event_kind {
+  CACHESIM_HIT = 0,        /* the line in the way was referenced */
+  CACHESIM_FILL = 1,       /* a missing line was placed in the way */
+  CACHESIM_INVALIDATE = 2  /* an invalidate record emptied the way */
+};
+
+typedef struct cachesim_event {
+  uint64_t tag;
+  uint32_t set;
+  uint16_t way;
+  uint16_t kind;
+} cachesim_event;
+
+typedef struct cachesim_policy {
+  /* must be CACHESIM_PLUGIN_ABI_VERSION */
+  uint32_t abi_version;
+
+  const char *name;
+
+  /* each set's metadata is set_metadata_bytes followed by
+     way_metadata_bytes for every way. it is zeroed at the start and
+     whenever the cache is flushed */
+  uint32_t set_metadata_bytes;
+  uint32_t way_metadata_bytes;
+
+  /* called once before the first event. args is the -pluginargs string,
+     or "" when none was given. the returned state is passed back to every
+     other call, and may be NULL */
+  void *(*create)(uint32_t sets, uint32_t ways, const char *args);
+
+  /* may be NULL */
+  void (*destroy)(void *state);
+
+  /* the whole cache was flushed and the metadata zeroed. may be NULL */
+  void (*reset)(void *state);
+
+  /* a batch of events. set s's metadata starts at metadata + s *
+     (set_metadata_bytes + ways * way_metadata_bytes) */
+  void (*update)(void *state, uint8_t *metadata,
+      const cachesim_event *events, size_t count);
+
+  /* returns the way to evict from a full set. tags holds the tag in each
+     of the set's ways */
+  uint32_t (*victim)(void *state, uint8_t *set_metadata, uint32_t set,
+      const uint64_t *tags, uint32_t ways);
+} cachesim_policy;
+
+/* the symbol every plugin exports */
+#define CACHESIM_POLICY_ENTRY "cachesim_get_policy"
+
+typedef const cachesim_policy *(*cachesim_policy_entry)(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,255 @@
+/* in-process trace emitter for cacheSim
+
+   an instrumented program records its own memory references into a
+   binary trace that cacheSim reads directly:
+
+     #include "cacheTraceEmitter.hpp"
+
+     cachetrace::Emitter emitter("app.trace");
+     ...
+     emitter.read(&x, sizeof(x));
+     emitter.write(&y, sizeof(y));
+     ...
+     emitter.close();
+
+   every thread appends to its own buffer without locking or atomics.
+   a full buffer goes to the file in one write() on a descriptor opened
+   with O_APPEND, so the chunks of different threads never interleave
+   inside each other. records carry the emitting thread, numbered from 0
+   in the order threads first emit, and a steady clock timestamp in
+   nanoseconds. reading the clock costs more than the rest of a record, so
+   a thread reads it once every clockInterval records, and the records in
+   between repeat the last reading. cacheSim merges the chunks back into
+   timestamp order, keeping each thread's records in the order they were
+   written, and uses the thread number as the core.
+
+   close() writes out every thread's partly filled buffer, so the threads
+   must have stopped emitting by then. the destructor calls it. a thread
+   keeps one buffer, for the emitter it used last, so a program should
+   emit to one emitter at a time.
+
+   the file is a 16 byte header, the magic "CSTRACE" and a NUL, then the
+   format version and the record size as little endian uint32, followed
+   by 24 byte records laid out as cachetrace::Record. op is the trace
+   letter: R, W, I (invalidate), F (flush, address ignored), M (fence,
+   address ignored) or A (address space switch, address holds the new id)
+*/
+
+#ifndef CACHE_TRACE_EMITTER_HPP
+#define CACHE_TRACE_EMITTER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace cachetrace {
+
+static const char magic[8] = {'C', 'S', 'T', 'R', 'A', 'C', 'E', 0};
+static const uint32_t version = 1;
+
+struct Record {
+  uint64_t address;
+  uint64_t timestamp;
+  uint32_t thread;
+  uint16_t size;
+  uint8_t op;
+  uint8_t reserved;
+};
+
+static_assert(sizeof(Record) == 24, "trace records are 24 bytes");
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t recordSize;
+};
+
+class Emitter
+{
+  public:
+
+    // creates or truncates the trace file. bufferRecords is the size of
+    // each thread's buffer. a clockInterval of 1 times every record
+    explicit Emitter(const char *filename, size_t bufferRecords = 8192,
+        unsigned clockInterval = 16)
+      : bufferRecords_(bufferRecords == 0 ? 1 : bufferRecords),
+      clockInterval_(clockInterval == 0 ? 1 : clockInterval),
+      generation_(next_generation()), failed_(false) {
+      fd_ = ::open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+      Header header;
+      memcpy(header.magic, magic, sizeof(magic));
+      header.version = version;
+      header.recordSize = sizeof(Record);
+      if (fd_ >= 0 && !write_all(&header, sizeof(header))) {
+        ::close(fd_);
+        fd_ = -1;
+      }
+    }
+
+    ~Emitter() {
+      close();
+    }
+
+    Emitter(const Emitter&) = delete;
+    Emitter &operator=(const Emitter&) = delete;
+
+    // false if the file could not be created, or a write to it failed
+    bool is_open() const {
+      return fd_ >= 0 && !failed_.load(std::memory_order_relaxed);
+    }
+
+    void read(const void *address, uint16_t size) {
+      record('R', (uint64_t)(uintptr_t)address, size);
+    }
+
+    void write(const void *address, uint16_t size) {
+      record('W', (uint64_t)(uintptr_t)address, size);
+    }
+
+    void invalidate(const void *address) {
+      record('I', (uint64_t)(uintptr_t)address, 0);
+    }
+
+    void flush_cache() {
+      record('F', 0, 0);
+    }
+
+    // drains the simulator's write-combining buffers
+    void fence() {
+      record('M', 0, 0);
+    }
+
+    void switch_address_space(uint32_t asid) {
+      record('A', asid, 0);
+    }
+
+    // appends a record to the calling thread's buffer
+    void record(char op, uint64_t address, uint16_t size) {
+      Buffer *buffer = local_buffer();
+      if (buffer->untimed == 0) {
+        buffer->timestamp =
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now().time_since_epoch()).count();
+        buffer->untimed = clockInterval_;
+      }
+      buffer->untimed--;
+      Record &entry = buffer->records[buffer->used++];
+      entry.address = address;
+      entry.timestamp = buffer->timestamp;
+      entry.thread = buffer->thread;
+      entry.size = size;
+      entry.op = op;
+      entry.reserved = 0;
+      if (buffer->used == bufferRecords_) {
+        drain(*buffer);
+      }
+    }
+
+    // writes out every thread's buffer and closes the file. no thread may
+    // be emitting
+    void close() {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (size_t b = 0; b < buffers_.size(); ++b) {
+        drain(*buffers_[b]);
+      }
+      if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+      }
+    }
+
+  private:
+
+    struct Buffer {
+      std::vector<Record> records;
+      size_t used;
+      uint32_t thread;
+
+      // the last clock reading, and the records left to stamp with it
+      uint64_t timestamp;
+      unsigned untimed;
+    };
+
+    // the calling thread's buffer, registered on its first record
+    Buffer *local_buffer() {
+      // emitters are told apart by generation, since a new one may be
+      // given the address of one that was destroyed
+      thread_local uint64_t generation = 0;
+      thread_local Buffer *buffer = nullptr;
+      if (generation != generation_) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        buffers_.emplace_back(new Buffer);
+        buffer = buffers_.back().get();
+        buffer->records.resize(bufferRecords_);
+        buffer->used = 0;
+        buffer->thread = buffers_.size() - 1;
+        buffer->untimed = 0;
+        generation = generation_;
+      }
+      return buffer;
+    }
+
+    // other threads may be writing to fd_, so a failed write only stops
+    // later ones, and the descriptor stays open until close()
+    void drain(Buffer &buffer) {
+      if (is_open() && buffer.used > 0
+          && !write_all(buffer.records.data(), buffer.used * sizeof(Record))) {
+        failed_.store(true, std::memory_order_relaxed);
+      }
+      buffer.used = 0;
+    }
+
+    bool write_all(const void *data, size_t bytes) {
+      const char *next = (const char*)data;
+      while (bytes > 0) {
+        ssize_t written = ::write(fd_, next, bytes);
+        if (written <= 0) {
+          return false;
+        }
+        next += written;
+        bytes -= written;
+      }
+      return true;
+    }
+
+    static uint64_t next_generation() {
+      static std::atomic<uint64_t> generations(0);
+      return ++generations;
+    }
+
+    int
+      fd_;
+
+    size_t
+      bufferRecords_;
+
+    unsigned
+      clockInterval_;
+
+    uint64_t
+      generation_;
+
+    // set once a write fails, by whichever thread saw it
+    std::atomic<bool>
+      failed_;
+
+    // guards buffers_, which only changes when a thread emits its first
+    // record
+    std::mutex
+      mutex_;
+
+    std::vector<std::unique_ptr<Buffer> >
+      buffers_;
+
+}; // end class Emitter
+
+} // namespace cachetrace
+
+#endif
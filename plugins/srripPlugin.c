@@ -0,0 +1,79 @@
+/* static re-reference interval prediction (SRRIP) as a cacheSim plugin.
+
+   every way keeps a 2-bit re-reference prediction value. new lines are
+   predicted to be re-referenced in the distant future, a hit predicts a
+   near re-reference, and the victim is a line predicted for the distant
+   future, ageing the whole set until there is one.
+
+     cc -shared -fPIC -I.. -o srripPlugin.so srripPlugin.c
+     cacheSim <cacheConfig> <memTrace> -plugin ./srripPlugin.so
+*/
+
+#include <stdlib.h>
+#include "cacheSimPlugin.h"
+
+#define MAX_RRPV 3
+
+typedef struct srrip_state {
+  uint32_t ways;
+} srrip_state;
+
+static void *srrip_create(uint32_t sets, uint32_t ways, const char *args) {
+  srrip_state *state = malloc(sizeof(srrip_state));
+  (void)sets;
+  (void)args;
+  state->ways = ways;
+  return state;
+}
+
+static void srrip_destroy(void *state) {
+  free(state);
+}
+
+static void srrip_update(void *state, uint8_t *metadata,
+    const cachesim_event *events, size_t count) {
+  uint32_t ways = ((srrip_state *)state)->ways;
+  size_t i;
+  for (i = 0; i < count; ++i) {
+    uint8_t *rrpv = metadata + (size_t)events[i].set * ways;
+    if (events[i].kind == CACHESIM_HIT) {
+      rrpv[events[i].way] = 0;
+    } else if (events[i].kind == CACHESIM_FILL) {
+      rrpv[events[i].way] = MAX_RRPV - 1;
+    }
+  }
+}
+
+static uint32_t srrip_victim(void *state, uint8_t *rrpv, uint32_t set,
+    const uint64_t *tags, uint32_t ways) {
+  uint32_t way;
+  (void)state;
+  (void)set;
+  (void)tags;
+  for (;;) {
+    for (way = 0; way < ways; ++way) {
+      if (rrpv[way] >= MAX_RRPV) {
+        return way;
+      }
+    }
+    for (way = 0; way < ways; ++way) {
+      rrpv[way]++;
+    }
+  }
+}
+
+static const cachesim_policy srrip = {
+  CACHESIM_PLUGIN_ABI_VERSION,
+  "srrip",
+  0,
+  1,
+  srrip_create,
+  srrip_destroy,
+  NULL,
+  srrip_update,
+  srrip_victim
+};
+
+const cachesim_policy *cachesim_get_policy(void) {
+  return &srrip;
+}